@@ -0,0 +1,114 @@
+#ifndef SMILEEXPLORER_DERIVATIVES_ADAPTIVE_PRICING_H_
+#define SMILEEXPLORER_DERIVATIVES_ADAPTIVE_PRICING_H_
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "derivatives/derivative.h"
+#include "derivatives/richardson_extrapolation.h"
+#include "derivatives/vanilla_option.h"
+#include "rates/rates_curve.h"
+#include "trees/binomial_tree.h"
+#include "trees/stochastic_tree_model.h"
+
+namespace smileexplorer {
+
+struct AccuracyTarget {
+  // The price is accepted once its error estimate is within either of these.
+  double absolute_error = 1e-4;
+  double relative_error = 0.0;
+
+  int initial_timesteps = 50;
+  int max_timesteps = 10000;
+
+  // The number of timesteps is multiplied by this on every refinement.
+  double growth_factor = 2.0;
+};
+
+struct AdaptivePrice {
+  double price;
+  double error_estimate;
+
+  // The number of timesteps until expiry of the tree which gave `price`.
+  int num_timesteps;
+
+  // False if max_timesteps was reached before the target. The error estimate
+  // is infinite if there was only room for one tree.
+  bool converged;
+};
+
+// Prices `option` on binomial trees with a growing number of timesteps until
+// the estimated error meets `target`, so that the number of timesteps need not
+// be picked by hand: easy options stop early, and hard ones keep refining.
+// The trees are generated as for priceWithRichardsonExtrapolation (see
+// priceOnTreeForExpiry).
+//
+// The error of the finest price is estimated from the change since the
+// previous tree, assuming that the error is O(1/N): after refining by a
+// factor g, it is |P_N - P_{N/g}| / (g - 1). Step counts keep the parity of
+// initial_timesteps (e.g. odd for LeisenReimerPropagator), so that the
+// odd/even oscillation of binomial prices does not pollute the estimate. As
+// for Richardson extrapolation, the estimate is more reliable with
+// TerminalSmoothing::kBlackScholes, which removes the oscillation with the
+// position of the strike between nodes. The backward inductions all run in
+// `workspace` if one is given, otherwise in one local to this call, so that
+// it is only grown by the refinements.
+template <typename PropagatorT, typename VolatilityT>
+AdaptivePrice priceToAccuracy(
+    const PropagatorT& propagator,
+    const VolatilityT& volatility,
+    const RatesCurve& curve,
+    const VanillaOption& option,
+    double expiry_years,
+    const AccuracyTarget& target = {},
+    TerminalSmoothing smoothing = TerminalSmoothing::kNone,
+    const RatesCurve* foreign_curve = nullptr,
+    PricingWorkspace* workspace = nullptr) {
+  PricingWorkspace local_workspace;
+  if (workspace == nullptr) {
+    workspace = &local_workspace;
+  }
+  AdaptivePrice result{
+      .price = 0.0,
+      .error_estimate = std::numeric_limits<double>::infinity(),
+      .num_timesteps = 0,
+      .converged = false};
+  int num_timesteps = std::max(2, target.initial_timesteps);
+  while (num_timesteps <= target.max_timesteps) {
+    const double price = priceOnTreeForExpiry(propagator,
+                                              volatility,
+                                              curve,
+                                              option,
+                                              expiry_years,
+                                              num_timesteps,
+                                              smoothing,
+                                              foreign_curve,
+                                              *workspace);
+
+    const bool refined = result.num_timesteps > 0;
+    if (refined) {
+      const double refinement =
+          static_cast<double>(num_timesteps) / result.num_timesteps;
+      result.error_estimate =
+          std::abs(price - result.price) / (refinement - 1);
+    }
+    result.price = price;
+    result.num_timesteps = num_timesteps;
+    if (refined && result.error_estimate <=
+                       std::max(target.absolute_error,
+                                target.relative_error * std::abs(price))) {
+      result.converged = true;
+      return result;
+    }
+
+    const int next =
+        std::ceil(num_timesteps * std::max(target.growth_factor, 1.1));
+    num_timesteps = next + (next - num_timesteps) % 2;
+  }
+  return result;
+}
+
+}  // namespace smileexplorer
+
+#endif  // SMILEEXPLORER_DERIVATIVES_ADAPTIVE_PRICING_H_
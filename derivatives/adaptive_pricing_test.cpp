@@ -0,0 +1,91 @@
+#include "derivatives/adaptive_pricing.h"
+
+#include <gtest/gtest.h>
+
+#include "rates/zero_curve.h"
+#include "trees/propagators.h"
+#include "volatility/volatility.h"
+
+namespace smileexplorer {
+namespace {
+
+TEST(AdaptivePricingTest, MeetsAccuracyTargets) {
+  ZeroSpotCurve curve(
+      {1.0, 10.0}, {0.05, 0.05}, CompoundingPeriod::kContinuous);
+  Volatility flat_vol(FlatVol(0.2));
+  PricingWorkspace workspace;
+
+  for (double strike : {90.0, 105.0}) {
+    const VanillaOption put(strike, OptionPayoff::Put);
+    const double bsm = put.blackScholes(100, 0.2, 1.0, 0.05, 0.0);
+    int num_timesteps = 0;
+    for (double tolerance : {1e-3, 2e-4}) {
+      const auto result = priceToAccuracy(CRRPropagator(100),
+                                          flat_vol,
+                                          curve,
+                                          put,
+                                          1.0,
+                                          {.absolute_error = tolerance},
+                                          TerminalSmoothing::kBlackScholes,
+                                          nullptr,
+                                          &workspace);
+      EXPECT_TRUE(result.converged);
+      EXPECT_LE(result.error_estimate, tolerance);
+      EXPECT_LT(std::abs(result.price - bsm), tolerance);
+
+      // Tighter targets need finer trees.
+      EXPECT_GT(result.num_timesteps, num_timesteps);
+      num_timesteps = result.num_timesteps;
+    }
+  }
+
+  // Relative targets.
+  const VanillaOption american_put(
+      100, OptionPayoff::Put, ExerciseStyle::American);
+  const auto american = priceToAccuracy(CRRPropagator(100),
+                                        flat_vol,
+                                        curve,
+                                        american_put,
+                                        1.0,
+                                        {.relative_error = 1e-4},
+                                        TerminalSmoothing::kBlackScholes);
+  EXPECT_TRUE(american.converged);
+  EXPECT_LE(american.error_estimate, 1e-4 * american.price);
+  EXPECT_NEAR(6.09039, american.price, 1e-4 * american.price);
+}
+
+TEST(AdaptivePricingTest, StepsFollowTheDifficulty) {
+  ZeroSpotCurve curve(
+      {1.0, 10.0}, {0.05, 0.05}, CompoundingPeriod::kContinuous);
+  Volatility flat_vol(FlatVol(0.2));
+  const VanillaOption call(105, OptionPayoff::Call);
+  const AccuracyTarget target{.absolute_error = 1e-4,
+                              .initial_timesteps = 25,
+                              .max_timesteps = 3200};
+
+  // Leisen-Reimer trees keep an odd number of steps, and converge quickly.
+  const auto leisen_reimer =
+      priceToAccuracy(LeisenReimerPropagator(curve, 100, 105, 1.0),
+                      flat_vol,
+                      curve,
+                      call,
+                      1.0,
+                      target);
+  EXPECT_TRUE(leisen_reimer.converged);
+  EXPECT_EQ(1, leisen_reimer.num_timesteps % 2);
+  EXPECT_LE(leisen_reimer.num_timesteps, 207);
+  EXPECT_NEAR(call.blackScholes(100, 0.2, 1.0, 0.05, 0.0),
+              leisen_reimer.price,
+              1e-4);
+
+  // Plain CRR prices oscillate with the strike between nodes, so that the
+  // target is not met within max_timesteps.
+  const auto crr =
+      priceToAccuracy(CRRPropagator(100), flat_vol, curve, call, 1.0, target);
+  EXPECT_FALSE(crr.converged);
+  EXPECT_GT(crr.error_estimate, 1e-4);
+  EXPECT_LE(crr.num_timesteps, 3200);
+}
+
+}  // namespace
+}  // namespace smileexplorer
@@ -0,0 +1,155 @@
+#ifndef SMILEEXPLORER_DERIVATIVES_BARRIER_OPTION_H_
+#define SMILEEXPLORER_DERIVATIVES_BARRIER_OPTION_H_
+
+#include <Eigen/Dense>
+#include <algorithm>
+#include <cmath>
+
+#include "derivatives/bsm.h"
+#include "derivatives/vanilla_option.h"
+
+namespace smileexplorer {
+
+enum class BarrierType { kUpAndOut, kDownAndOut, kUpAndIn, kDownAndIn };
+
+// A vanilla option which is knocked out (or in) as soon as the asset touches
+// the barrier. In a tree, the barrier is monitored at every timeslice, and
+// every node on or beyond it is knocked out.
+//
+// Knock-in options are priced by in-out parity, i.e. as the vanilla option
+// less the knock-out option, which only holds without early exercise.
+class BarrierOption {
+ public:
+  BarrierOption(const VanillaOption& option, double barrier, BarrierType type)
+      : option_(option), barrier_(barrier), type_(type) {}
+
+  const VanillaOption& vanilla() const { return option_; }
+  double barrier() const { return barrier_; }
+  BarrierType type() const { return type_; }
+
+  bool isKnockIn() const {
+    return type_ == BarrierType::kUpAndIn || type_ == BarrierType::kDownAndIn;
+  }
+  bool isUpBarrier() const {
+    return type_ == BarrierType::kUpAndOut || type_ == BarrierType::kUpAndIn;
+  }
+
+  // The knock-out option with the same barrier.
+  BarrierOption asKnockOut() const {
+    return BarrierOption(option_,
+                         barrier_,
+                         isUpBarrier() ? BarrierType::kUpAndOut
+                                       : BarrierType::kDownAndOut);
+  }
+
+  // Closed-form value with a continuously monitored barrier, for a spot on the
+  // live side of the barrier. Early exercise is ignored.
+  double blackScholes(
+      double spot, double vol, double t, double r, double div) const {
+    const double knock_out_price = knock_out(spot,
+                                             option_.strike(),
+                                             barrier_,
+                                             vol,
+                                             t,
+                                             r,
+                                             div,
+                                             option_.isCall(),
+                                             isUpBarrier());
+    if (isKnockIn()) {
+      return option_.blackScholes(spot, vol, t, r, div) - knock_out_price;
+    }
+    return knock_out_price;
+  }
+
+  // Row-wise interface used by binomial backward induction (see
+  // VanillaOption), for the knock-out option.
+  template <typename StatesT>
+  auto payoff(const Eigen::ArrayBase<StatesT>& states) const {
+    return alive(states).select(option_.payoff(states), 0.0);
+  }
+  bool hasEarlyExercise() const { return option_.hasEarlyExercise(); }
+
+  // Sets `values` to zero at the nodes whose `states` are on or beyond the
+  // barrier. Backward induction applies this to every timeslice.
+  template <typename StatesT, typename ValuesT>
+  void knockOut(const Eigen::ArrayBase<StatesT>& states,
+                ValuesT&& values) const {
+    values = alive(states).select(values, 0.0);
+  }
+
+  // Closed-form knock-out values over a period `t` from each of `states`
+  // (see VanillaOption::blackScholesTimeslice), with the barrier monitored
+  // continuously over the period. Zero on or beyond the barrier.
+  void blackScholesTimeslice(const Eigen::Ref<const Eigen::ArrayXd>& states,
+                             const Eigen::Ref<const Eigen::ArrayXd>& vols,
+                             double t,
+                             double r,
+                             double div,
+                             Eigen::Ref<Eigen::ArrayXd> out) const {
+    for (Eigen::Index i = 0; i < states.size(); ++i) {
+      out[i] = knock_out(states[i],
+                         option_.strike(),
+                         barrier_,
+                         vols[i],
+                         t,
+                         r,
+                         div,
+                         option_.isCall(),
+                         isUpBarrier());
+    }
+    knockOut(states, out);
+  }
+
+ private:
+  VanillaOption option_;
+  double barrier_;
+  BarrierType type_;
+
+  // True strictly inside the barrier.
+  template <typename StatesT>
+  auto alive(const Eigen::ArrayBase<StatesT>& states) const {
+    const double sign = isUpBarrier() ? 1.0 : -1.0;
+    return sign * (states - barrier_) < 0.0;
+  }
+};
+
+// The number of timesteps until expiry, at least `min_timesteps`, for which a
+// CRR tree under the flat vol `vol` has a layer of nodes on the barrier.
+// This assumes that the tree's spine stays at `spot` and that its moves are
+// those of CRR under a flat vol; trees with a drift in their moves (e.g.
+// Jarrow-Rudd), a term structure or a smile of vol need not have a layer of
+// nodes anywhere near the barrier.
+//
+// A binomial tree effectively moves the barrier out to the first layer of
+// nodes beyond it, which makes barrier prices converge slowly and erratically
+// with the number of timesteps. CRR layers lie at spot * exp(k * vol *
+// sqrt(dt)), so the timesteps are chosen (as in Boyle and Lau, 1994) such
+// that the barrier lies just inside the m-th layer, for the smallest m which
+// allows min_timesteps. The layer then lies within O(1/N) of the barrier in
+// log space, and barrier prices converge at the same rate as vanilla ones.
+inline int barrierAlignedTimesteps(double spot,
+                                   double barrier,
+                                   double vol,
+                                   double expiry_years,
+                                   int min_timesteps) {
+  const double log_distance = std::abs(std::log(barrier / spot));
+  if (log_distance == 0.0) {
+    return min_timesteps;
+  }
+  const double variance = vol * vol * expiry_years;
+  const int m = std::max(
+      1,
+      static_cast<int>(
+          std::ceil(log_distance * std::sqrt(min_timesteps / variance))));
+  for (int layer = m;; ++layer) {
+    const int num_timesteps = std::floor(
+        layer * layer * variance / (log_distance * log_distance));
+    if (num_timesteps >= min_timesteps) {
+      return num_timesteps;
+    }
+  }
+}
+
+}  // namespace smileexplorer
+
+#endif  // SMILEEXPLORER_DERIVATIVES_BARRIER_OPTION_H_
@@ -0,0 +1,84 @@
+#include "derivatives/barrier_option.h"
+
+#include <gtest/gtest.h>
+
+namespace smileexplorer {
+namespace {
+
+TEST(BarrierOptionTest, KnocksOutOnAndBeyondTheBarrier) {
+  const Eigen::ArrayXd states{{90, 110, 120, 130}};
+  const BarrierOption up_and_out(
+      VanillaOption(100, OptionPayoff::Call), 120, BarrierType::kUpAndOut);
+  EXPECT_TRUE(
+      (up_and_out.payoff(states) == Eigen::ArrayXd{{0, 10, 0, 0}}).all());
+
+  const BarrierOption down_and_out(
+      VanillaOption(100, OptionPayoff::Put), 90, BarrierType::kDownAndOut);
+  EXPECT_TRUE(
+      (down_and_out.payoff(states) == Eigen::ArrayXd{{0, 0, 0, 0}}).all());
+
+  Eigen::ArrayXd values{{1, 2, 3, 4}};
+  down_and_out.knockOut(states, values);
+  EXPECT_TRUE((values == Eigen::ArrayXd{{0, 2, 3, 4}}).all());
+}
+
+TEST(BarrierOptionTest, ClosedFormLimits) {
+  const double spot = 100, vol = 0.2, t = 1.0, r = 0.05, div = 0.02;
+  for (auto payoff : {OptionPayoff::Call, OptionPayoff::Put}) {
+    for (double strike : {90.0, 100.0, 110.0}) {
+      const VanillaOption vanilla(strike, payoff);
+      const double vanilla_price = vanilla.blackScholes(spot, vol, t, r, div);
+
+      // Barriers which are never reached.
+      EXPECT_NEAR(vanilla_price,
+                  BarrierOption(vanilla, 1e-3, BarrierType::kDownAndOut)
+                      .blackScholes(spot, vol, t, r, div),
+                  1e-10);
+      EXPECT_NEAR(vanilla_price,
+                  BarrierOption(vanilla, 1e4, BarrierType::kUpAndOut)
+                      .blackScholes(spot, vol, t, r, div),
+                  1e-10);
+
+      // In-out parity.
+      for (auto [in, out] :
+           {std::pair(BarrierType::kDownAndIn, BarrierType::kDownAndOut),
+            std::pair(BarrierType::kUpAndIn, BarrierType::kUpAndOut)}) {
+        const double barrier = in == BarrierType::kDownAndIn ? 85 : 120;
+        EXPECT_NEAR(vanilla_price,
+                    BarrierOption(vanilla, barrier, in)
+                            .blackScholes(spot, vol, t, r, div) +
+                        BarrierOption(vanilla, barrier, out)
+                            .blackScholes(spot, vol, t, r, div),
+                    1e-12);
+      }
+    }
+  }
+
+  // A call which can only pay beyond an up barrier is worthless.
+  EXPECT_DOUBLE_EQ(0.0,
+                   BarrierOption(VanillaOption(110, OptionPayoff::Call),
+                                 105,
+                                 BarrierType::kUpAndOut)
+                       .blackScholes(spot, vol, t, r, div));
+}
+
+TEST(BarrierOptionTest, AlignedTimestepsPutALayerOnTheBarrier) {
+  for (double barrier : {80.0, 90.0, 120.0}) {
+    for (int min_timesteps : {50, 400, 1000}) {
+      const int num_timesteps =
+          barrierAlignedTimesteps(100, barrier, 0.2, 1.0, min_timesteps);
+      EXPECT_GE(num_timesteps, min_timesteps);
+      EXPECT_LT(num_timesteps, 2 * min_timesteps);
+
+      // The barrier lies just inside a layer, within O(1/N) of the distance
+      // to it.
+      const double layer_spacing = 0.2 * std::sqrt(1.0 / num_timesteps);
+      const double layers = std::abs(std::log(barrier / 100)) / layer_spacing;
+      const double gap = std::ceil(layers) - layers;
+      EXPECT_LT(gap, layers / num_timesteps);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace smileexplorer
@@ -100,6 +100,50 @@ inline double put_theta(
          (div * S * bsm_vals.e_neg_bt * normsdist(-bsm_vals.d1));
 }
 
+// BSM price of a call or put which is knocked out as soon as the (continuously
+// monitored) asset touches the barrier H, without a rebate. Expects the spot
+// to be on the live side of the barrier (below an up barrier, above a down
+// barrier). See Haug, "The Complete Guide to Option Pricing Formulas".
+inline double knock_out(double S,
+                        double K,
+                        double H,
+                        double vol,
+                        double t,
+                        double r,
+                        double div,
+                        bool is_call,
+                        bool is_up_barrier) {
+  const double phi = is_call ? 1.0 : -1.0;
+  const double eta = is_up_barrier ? -1.0 : 1.0;
+  const double nu = vol * std::sqrt(t);
+  const double mu = (r - div - 0.5 * vol * vol) / (vol * vol);
+  const double fwd_factor = S * std::exp(-div * t);
+  const double df = std::exp(-r * t);
+
+  // The vanilla payoff, cut off at the barrier (A, B), and their reflections
+  // in the barrier (C, D).
+  const auto cut_off = [&](double x) {
+    return phi * fwd_factor * normsdist(phi * x) -
+           phi * K * df * normsdist(phi * (x - nu));
+  };
+  const auto reflected = [&](double y) {
+    return phi * fwd_factor * std::pow(H / S, 2 * (mu + 1)) *
+               normsdist(eta * y) -
+           phi * K * df * std::pow(H / S, 2 * mu) * normsdist(eta * (y - nu));
+  };
+  const double A = cut_off(std::log(S / K) / nu + (1 + mu) * nu);
+  const double B = cut_off(std::log(S / H) / nu + (1 + mu) * nu);
+  const double C = reflected(std::log(H * H / (S * K)) / nu + (1 + mu) * nu);
+  const double D = reflected(std::log(H / S) / nu + (1 + mu) * nu);
+
+  const bool strike_beyond_barrier = is_up_barrier ? K >= H : K <= H;
+  if (is_call == is_up_barrier) {
+    // The payoff grows towards the barrier.
+    return strike_beyond_barrier ? 0.0 : A - B + C - D;
+  }
+  return strike_beyond_barrier ? B - D : A - C;
+}
+
 }  // namespace smileexplorer
 
 #endif  // SMILE_EXPLORER_DERIVATIVES_BSM_
\ No newline at end of file
@@ -1,8 +1,26 @@
 #ifndef SMILEEXPLORER_DERIVATIVES_DERIVATIVE_H_
 #define SMILEEXPLORER_DERIVATIVES_DERIVATIVE_H_
 
+#include <Eigen/Dense>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <tuple>
+#include <utility>
+#include <vector>
+
 #include "absl/log/log.h"
+#include "derivatives/barrier_option.h"
+#include "derivatives/european_payoffs.h"
+#include "derivatives/thread_pool.h"
 #include "rates/rates_curve.h"
+#include "trees/binomial_transition_table.h"
 #include "trees/binomial_tree.h"
 #include "vanilla_option.h"
 
@@ -15,108 +33,1065 @@ class Derivative {
   virtual ~Derivative() = default;
 };
 
+// Determines how much of the derivative tree is retained during backward
+// induction.
+enum class BackwardInductionStorage {
+  // Every timeslice of the derivative tree is populated and can be inspected
+  // (e.g. plotted) via binomialTree(). The tree is stored in the same
+  // precision as the asset tree (see StoragePrecision).
+  kFullTree,
+
+  // Only two reusable timeslices are kept, so pricing needs O(N) scratch
+  // memory instead of O(N^2). binomialTree() is left empty.
+  kRollingTimeslices,
+};
+
+// How the last backward step (from expiry to the timeslice before it) is
+// taken.
+enum class TerminalSmoothing {
+  // Discounted expectation over the tree, like every other step.
+  kNone,
+
+  // Binomial Black-Scholes (BBS): the values one step before expiry are the
+  // closed-form Black-Scholes values over the remaining timestep, so that the
+  // kink in the payoff does not cause the usual oscillating binomial error.
+  // The volatility at each node is implied by the spacing of its children.
+  kBlackScholes,
+};
+
+// The price of a derivative together with sensitivities read off the
+// derivative tree near its root. Units follow VanillaOption::blackScholesGreek:
+// theta is per calendar day and vega is per vol point.
+struct TreeGreeks {
+  double price = 0.0;
+  double delta = 0.0;
+  double gamma = 0.0;
+  double theta = 0.0;
+
+  // Only available when priced alongside a vol-bumped asset tree.
+  std::optional<double> vega;
+};
+
+// Scratch memory for pricing binomial derivatives: the transition table, the
+// timeslice buffers used during backward induction and the derivative tree.
+// A workspace is owned by the caller and reused across pricing calls, so that
+// once it has grown to the size of the tree, repricing does no heap
+// allocations. Buffers only ever grow (at least doubling each
+// time), so pricing on ever larger trees reallocates O(log N) times.
+//
+// The const pricing methods of SingleAssetDerivative only write into the
+// workspace which is passed in, so a single derivative can be priced from
+// several threads concurrently, with one workspace per thread.
+class PricingWorkspace {
+ public:
+  // Preallocates timeslices of `num_nodes` nodes, with `num_columns` value
+  // channels each (see SingleAssetDerivative::priceBatch). Pricing grows the
+  // workspace as needed, so this is optional.
+  void reserve(int num_nodes, int num_columns = 1) {
+    grow(states_, num_nodes);
+    grow(next_states_, num_nodes);
+    grow(up_probs_, num_nodes);
+    grow(vols_, num_nodes);
+    grow(state_prices_, num_nodes);
+    grow(next_values_, num_nodes, num_columns);
+    grow(curr_values_, num_nodes, num_columns);
+  }
+
+  // Populated by pricing with BackwardInductionStorage::kFullTree.
+  const BinomialTree& derivativeTree() const { return deriv_tree_; }
+
+ private:
+  friend class SingleAssetDerivative;
+
+  template <typename ArrayT>
+  static void grow(ArrayT& buffer, Eigen::Index rows, Eigen::Index cols = 1) {
+    if (buffer.rows() >= rows && buffer.cols() >= cols) {
+      return;
+    }
+    buffer.resize(
+        buffer.rows() < rows ? std::max(rows, 2 * buffer.rows())
+                             : buffer.rows(),
+        buffer.cols() < cols ? std::max(cols, 2 * buffer.cols())
+                             : buffer.cols());
+  }
+
+  // Updated at the start of every pricing call, so that the curve lookups
+  // are done once per timestep rather than once per node. This is a no-op
+  // while the asset tree and curves stay the same.
+  BinomialTransitionTable transitions_;
+
+  // Asset states at the current and next time index of a backward
+  // induction, the up-probabilities out of the current time index, and the
+  // local volatilities for terminal smoothing.
+  Eigen::ArrayXd states_;
+  Eigen::ArrayXd next_states_;
+  Eigen::ArrayXd up_probs_;
+  Eigen::ArrayXd vols_;
+
+  // Arrow-Debreu prices at a single time index (see priceEuropeanBatch and
+  // arrowDebreuTree).
+  Eigen::ArrayXd state_prices_;
+
+  // Derivative values at the next and current time index, with one column per
+  // value channel. Only the top-left corner is in use.
+  Eigen::ArrayXXd next_values_;
+  Eigen::ArrayXXd curr_values_;
+
+  BinomialTree deriv_tree_;
+
+  // Replaces the asset tree of the derivative for the duration of a single
+  // backward induction, if not null. Not owned.
+  const BinomialTree* asset_tree_override_ = nullptr;
+};
+
+// The Arrow-Debreu tree of an asset tree under a discount curve (and, for
+// currency derivatives, a foreign curve), i.e. the price today of a unit
+// payment at each node, along with the versions of the asset tree and curves
+// which it was computed from. Computing it takes an up-probability per node,
+// so it is only recomputed once one of these has changed (see
+// BinomialTree::version and RatesCurve::version). All the derivatives on the
+// same asset tree and curves share the same cache.
+class ArrowDebreuCache {
+ public:
+  // The cache for the derivatives on `asset_tree` under `curve` and
+  // `foreign_curve` (if any), which lives for as long as any of them which
+  // has used it does.
+  static std::shared_ptr<ArrowDebreuCache> forInputs(
+      const BinomialTree* asset_tree,
+      const RatesCurve* curve,
+      const RatesCurve* foreign_curve = nullptr) {
+    static std::mutex registry_mutex;
+    static std::map<std::tuple<const BinomialTree*,
+                               const RatesCurve*,
+                               const RatesCurve*>,
+                    std::weak_ptr<ArrowDebreuCache>>
+        registry;
+    std::lock_guard lock(registry_mutex);
+    std::erase_if(registry,
+                  [](const auto& entry) { return entry.second.expired(); });
+    std::weak_ptr<ArrowDebreuCache>& entry =
+        registry[{asset_tree, curve, foreign_curve}];
+    std::shared_ptr<ArrowDebreuCache> cache = entry.lock();
+    if (cache == nullptr) {
+      cache = std::make_shared<ArrowDebreuCache>();
+      entry = cache;
+    }
+    return cache;
+  }
+
+  // Exposed for testing.
+  int numUpdates() const { return num_updates_; }
+
+ private:
+  friend class SingleAssetDerivative;
+
+  struct Inputs {
+    BinomialTree::Version asset_tree;
+    uint64_t curve;
+    std::optional<uint64_t> foreign_curve;
+
+    bool operator==(const Inputs&) const = default;
+  };
+
+  std::mutex mutex_;
+  std::optional<Inputs> inputs_;
+
+  // Handed out as an immutable snapshot. It is only updated in place while
+  // no one else holds it; otherwise a new tree takes its place.
+  std::shared_ptr<BinomialTree> tree_;
+  int num_updates_ = 0;
+};
+
 class SingleAssetDerivative : public Derivative {
  public:
-  SingleAssetDerivative(const BinomialTree* asset_tree, const RatesCurve* curve)
-      : deriv_tree_(BinomialTree::createFrom(*asset_tree)),
-        arrow_debreu_tree_(BinomialTree::createFrom(*asset_tree)),
-        asset_tree_(asset_tree),
-        curve_(curve) {}
+  SingleAssetDerivative(
+      const BinomialTree* asset_tree,
+      const RatesCurve* curve,
+      BackwardInductionStorage storage = BackwardInductionStorage::kFullTree,
+      TerminalSmoothing smoothing = TerminalSmoothing::kNone)
+      : SingleAssetDerivative(
+            asset_tree, curve, nullptr, storage, smoothing) {}
 
+  // The methods without a PricingWorkspace argument use a workspace owned by
+  // this derivative, so they are not safe to call concurrently.
   double price(const VanillaOption& vanilla_option,
                double expiry_years) override {
-    runBackwardInduction(vanilla_option, expiry_years);
-    return deriv_tree_.nodeValue(0, 0);
+    return price(vanilla_option, expiry_years, workspace_);
+  }
+
+  double price(const VanillaOption& vanilla_option,
+               double expiry_years,
+               PricingWorkspace& workspace) const {
+    return vanilla_option.dispatch([&](const auto& option) {
+      if (storage_ == BackwardInductionStorage::kRollingTimeslices) {
+        return runRollingBackwardInduction(option, expiry_years, workspace);
+      }
+      return runBackwardInduction(option, expiry_years, workspace);
+    });
   }
 
-  const BinomialTree& binomialTree() const { return deriv_tree_; }
+  double price(const BarrierOption& barrier_option, double expiry_years) {
+    return price(barrier_option, expiry_years, workspace_);
+  }
 
-  // Exposed for testing.
-  const BinomialTree& arrowDebreuTree() {
-    updateArrowDebreuPrices();
-    return arrow_debreu_tree_;
+  // Knock-out options are priced in a single backward induction, in which
+  // the nodes on or beyond the barrier are knocked out at every timeslice.
+  // Knock-in options take one more, for the vanilla option (see
+  // BarrierOption). The barrier is only resolved up to the spacing of the
+  // nodes, so use a tree with a layer of nodes on the barrier (see
+  // barrierAlignedTimesteps).
+  double price(const BarrierOption& barrier_option,
+               double expiry_years,
+               PricingWorkspace& workspace) const {
+    if (barrier_option.isKnockIn()) {
+      if (barrier_option.hasEarlyExercise()) {
+        LOG(ERROR) << "Knock-in options with early exercise are unsupported.";
+        return 0.0;
+      }
+      return price(barrier_option.vanilla(), expiry_years, workspace) -
+             price(barrier_option.asKnockOut(), expiry_years, workspace);
+    }
+    if (storage_ == BackwardInductionStorage::kRollingTimeslices) {
+      return runRollingBackwardInduction(
+          barrier_option, expiry_years, workspace);
+    }
+    return runBackwardInduction(barrier_option, expiry_years, workspace);
+  }
+
+  TreeGreeks priceWithGreeks(const VanillaOption& vanilla_option,
+                             double expiry_years) {
+    return priceWithGreeks(vanilla_option, expiry_years, workspace_);
+  }
+
+  // Prices the option and reads delta, gamma and theta directly off the
+  // derivative values at time indices 1 and 2, so that they come out of the
+  // same backward induction as the price (in either storage mode). Theta is
+  // taken between the root and the middle node at time index 2. That node is
+  // the spot itself in a CRR tree, but not in trees with drift (such as
+  // Jarrow-Rudd) or with local vol, so the change in value due to the move
+  // in the asset is removed with the delta and gamma. The expiry must lie at
+  // least two timesteps into the tree, otherwise only the price is returned.
+  TreeGreeks priceWithGreeks(const VanillaOption& vanilla_option,
+                             double expiry_years,
+                             PricingWorkspace& workspace) const {
+    RootTimeslices root_values = RootTimeslices::Zero();
+    TreeGreeks greeks;
+    greeks.price = vanilla_option.dispatch([&](const auto& option) {
+      if (storage_ == BackwardInductionStorage::kRollingTimeslices) {
+        return runRollingBackwardInduction(
+            option, expiry_years, workspace, &root_values);
+      }
+      return runBackwardInduction(
+          option, expiry_years, workspace, &root_values);
+    });
+
+    auto ti_final_or =
+        asset_tree_->getTimegrid().getTimeIndexForExpiry(expiry_years);
+    if (ti_final_or.value_or(0) < 2) {
+      LOG(ERROR) << "Tree Greeks need at least two timesteps until expiry "
+                 << expiry_years;
+      return greeks;
+    }
+
+    const auto s = [this](int t, int i) {
+      return asset_tree_->nodeValue(t, i);
+    };
+    const auto& v = root_values;
+    greeks.delta = (v(1, 1) - v(1, 0)) / (s(1, 1) - s(1, 0));
+
+    const double delta_up = (v(2, 2) - v(2, 1)) / (s(2, 2) - s(2, 1));
+    const double delta_down = (v(2, 1) - v(2, 0)) / (s(2, 1) - s(2, 0));
+    greeks.gamma = (delta_up - delta_down) / (0.5 * (s(2, 2) - s(2, 0)));
+
+    const auto& timegrid = asset_tree_->getTimegrid();
+    const double spot_move = s(2, 1) - s(0, 0);
+    const double value_change = v(2, 1) - v(0, 0) -
+                                greeks.delta * spot_move -
+                                0.5 * greeks.gamma * spot_move * spot_move;
+    greeks.theta =
+        value_change / (timegrid.time(2) - timegrid.time(0)) / 365.;
+    return greeks;
+  }
+
+  TreeGreeks priceWithGreeks(const VanillaOption& vanilla_option,
+                             double expiry_years,
+                             const BinomialTree& vol_bumped_asset_tree,
+                             double vol_bump) {
+    return priceWithGreeks(vanilla_option,
+                           expiry_years,
+                           vol_bumped_asset_tree,
+                           vol_bump,
+                           workspace_);
+  }
+
+  // As above, and additionally computes vega by repricing on
+  // `vol_bumped_asset_tree`. This must be the same asset model, forward
+  // propagated with the volatility raised by `vol_bump` (e.g. 0.01).
+  TreeGreeks priceWithGreeks(const VanillaOption& vanilla_option,
+                             double expiry_years,
+                             const BinomialTree& vol_bumped_asset_tree,
+                             double vol_bump,
+                             PricingWorkspace& workspace) const {
+    TreeGreeks greeks =
+        priceWithGreeks(vanilla_option, expiry_years, workspace);
+
+    // The bumped price only needs the root, so the derivative tree is left
+    // untouched.
+    workspace.asset_tree_override_ = &vol_bumped_asset_tree;
+    const double bumped_price =
+        vanilla_option.dispatch([&](const auto& option) {
+          return runRollingBackwardInduction(option, expiry_years, workspace);
+        });
+    workspace.asset_tree_override_ = nullptr;
+
+    greeks.vega = (bumped_price - greeks.price) / vol_bump * 0.01;
+    return greeks;
+  }
+
+  double priceWithControlVariate(const VanillaOption& option,
+                                 double expiry_years,
+                                 double vol) {
+    return priceWithControlVariate(option, expiry_years, vol, workspace_);
+  }
+
+  // Prices an American option with its European counterpart as a control
+  // variate. A single backward induction (see priceBatch) carries both values,
+  // and the American price is corrected by the tree error of the European
+  // one:
+  //   V = V_tree(American) + V_bsm(European) - V_tree(European).
+  // Both tree prices share most of their discretisation error, so that this
+  // needs several times fewer timesteps for the same accuracy. This works best
+  // with TerminalSmoothing::kBlackScholes, which makes the error a smooth
+  // function of the number of timesteps. `vol` is the flat vol which the asset
+  // tree was propagated with, and the Black-Scholes rates are the
+  // continuously compounded rates of the curves until expiry. European
+  // options are priced by Black-Scholes directly.
+  double priceWithControlVariate(const VanillaOption& option,
+                                 double expiry_years,
+                                 double vol,
+                                 PricingWorkspace& workspace) const {
+    if (!asset_tree_->getTimegrid().getTimeIndexForExpiry(expiry_years)) {
+      LOG(ERROR) << "Backward induction is impossible for requested expiry "
+                 << expiry_years;
+      return 0.0;
+    }
+    const VanillaOption european = option.asEuropean();
+    const double r = -std::log(curve_->df(expiry_years)) / expiry_years;
+    const double div =
+        foreignCurve() == nullptr
+            ? 0.0
+            : -std::log(foreignCurve()->df(expiry_years)) / expiry_years;
+    const double bsm_european = european.blackScholes(
+        asset_tree_->nodeValue(0, 0), vol, expiry_years, r, div);
+    if (!option.hasEarlyExercise()) {
+      return bsm_european;
+    }
+
+    const std::array options = {option, european};
+    const std::vector<double> tree_prices =
+        priceBatch(options, expiry_years, workspace);
+    return tree_prices[0] + bsm_european - tree_prices[1];
+  }
+
+  std::vector<double> priceBatch(std::span<const VanillaOption> options,
+                                 double expiry_years) {
+    return priceBatch(options, expiry_years, workspace_);
+  }
+
+  // Prices several options with the same expiry in a single backward
+  // induction, in which every node holds one value per option. The asset
+  // states and up-probabilities are shared by all the options, which makes
+  // this much cheaper than pricing them one at a time. Returns the prices in
+  // the same order as `options`. The derivative tree is not populated.
+  std::vector<double> priceBatch(std::span<const VanillaOption> options,
+                                 double expiry_years,
+                                 PricingWorkspace& workspace) const {
+    return priceSurface(options, std::span(&expiry_years, 1), workspace)
+        .front();
+  }
+
+  std::vector<std::vector<double>> priceSurface(
+      std::span<const VanillaOption> options,
+      std::span<const double> expiries_years) {
+    return priceSurface(options, expiries_years, workspace_);
+  }
+
+  // Prices every combination of `options` and `expiries_years` with a single
+  // backward induction, starting from the longest expiry. The values for each
+  // shorter expiry are injected (as the payoff) once the sweep reaches its
+  // time index. Returns prices[e][k] for expiries_years[e] and options[k].
+  // Prices for an expiry outside the tree are left at 0.
+  std::vector<std::vector<double>> priceSurface(
+      std::span<const VanillaOption> options,
+      std::span<const double> expiries_years,
+      PricingWorkspace& workspace) const {
+    const int num_options = options.size();
+    std::vector<std::vector<double>> prices(
+        expiries_years.size(), std::vector<double>(num_options, 0.0));
+
+    // Value channels are grouped in blocks of num_options columns, one block
+    // per expiry, with the latest expiry first. This way, the channels which
+    // are alive at any time index are always the leftmost columns.
+    struct ExpiryChannels {
+      int ti_final;
+      int expiry_index;
+    };
+    std::vector<ExpiryChannels> channels;
+    for (size_t e = 0; e < expiries_years.size(); ++e) {
+      auto ti_final_or =
+          asset_tree_->getTimegrid().getTimeIndexForExpiry(expiries_years[e]);
+      if (ti_final_or == std::nullopt) {
+        LOG(ERROR) << "Backward induction is impossible for requested expiry "
+                   << expiries_years[e];
+        continue;
+      }
+      channels.push_back({ti_final_or.value(), static_cast<int>(e)});
+    }
+    if (channels.empty()) {
+      return prices;
+    }
+    std::ranges::stable_sort(
+        channels, std::ranges::greater(), &ExpiryChannels::ti_final);
+    const int ti_max = channels.front().ti_final;
+    const int num_columns = channels.size() * num_options;
+    updateTransitionTable(workspace);
+    workspace.reserve(ti_max + 1, num_columns);
+
+    int num_alive = 0;
+    for (int ti = ti_max; ti >= 0; --ti) {
+      if (ti == ti_max) {
+        copyMaterializedStates(ti, workspace);
+      } else {
+        stepBackTimeslice(ti, workspace);
+      }
+      const NodeRange active = asset_tree_->activeNodes(ti);
+      const NodeRange stored = asset_tree_->materializedNodes(ti);
+      auto curr = workspace.curr_values_.topRows(ti + 1);
+
+      // Roll back the channels which are already alive.
+      if (num_alive > 0) {
+        const auto states =
+            workspace.states_.segment(active.first, active.size());
+        const auto p = workspace.up_probs_.segment(active.first, active.size());
+        const auto next =
+            workspace.next_values_.leftCols(num_alive * num_options);
+        curr.middleRows(active.first, active.size())
+            .leftCols(num_alive * num_options) =
+            forwardDF(ti, workspace) *
+            (next.middleRows(active.first + 1, active.size()).colwise() * p +
+             next.middleRows(active.first, active.size()).colwise() * (1 - p));
+        for (int block = 0; block < num_alive; ++block) {
+          const int ti_final = channels[block].ti_final;
+          const bool smooth = smoothing_ == TerminalSmoothing::kBlackScholes &&
+                              ti_final == ti + 1;
+          for (int k = 0; k < num_options; ++k) {
+            auto col = curr.col(block * num_options + k);
+            if (smooth) {
+              smoothTimeslice(options[k], ti, col, workspace);
+            } else if (options[k].hasEarlyExercise()) {
+              auto active_col = col.segment(active.first, active.size());
+              active_col = active_col.max(options[k].payoff(states));
+            }
+            fillTruncationBoundary(options[k], ti, ti_final, col, workspace);
+          }
+        }
+      }
+
+      // Inject the payoffs of the options which expire at this time index.
+      while (num_alive < std::ssize(channels) &&
+             channels[num_alive].ti_final == ti) {
+        const auto states =
+            workspace.states_.segment(stored.first, stored.size());
+        for (int k = 0; k < num_options; ++k) {
+          curr.col(num_alive * num_options + k)
+              .segment(stored.first, stored.size()) = options[k].payoff(states);
+        }
+        ++num_alive;
+      }
+      workspace.next_values_.swap(workspace.curr_values_);
+    }
+
+    for (int block = 0; block < std::ssize(channels); ++block) {
+      for (int k = 0; k < num_options; ++k) {
+        prices[channels[block].expiry_index][k] =
+            workspace.next_values_(0, block * num_options + k);
+      }
+    }
+    return prices;
+  }
+
+  std::vector<double> priceSpotLadder(const VanillaOption& option,
+                                      double expiry_years,
+                                      std::span<const double> spots) {
+    return priceSpotLadder(option, expiry_years, spots, workspace_);
+  }
+
+  // Prices `option` for each of `spots`, without rebuilding the asset tree.
+  // This needs an implicit lattice (see BinomialTree::setImplicitLattice),
+  // which scales linearly with spot, so that the option value is homogeneous
+  // in spot and strike: V(S, K) = (S / S_0) * V(S_0, K * S_0 / S), where S_0
+  // is the spot of the asset tree. All the rescaled strikes are priced
+  // together by priceBatch, i.e. with a single backward induction. Returns
+  // zeros for any other kind of tree.
+  std::vector<double> priceSpotLadder(const VanillaOption& option,
+                                      double expiry_years,
+                                      std::span<const double> spots,
+                                      PricingWorkspace& workspace) const {
+    if (!asset_tree_->isImplicitLattice()) {
+      LOG(ERROR) << "Spot ladders need a tree which scales with the spot.";
+      return std::vector<double>(spots.size(), 0.0);
+    }
+    const double tree_spot = asset_tree_->nodeValue(0, 0);
+    std::vector<VanillaOption> rescaled_options;
+    rescaled_options.reserve(spots.size());
+    for (double spot : spots) {
+      rescaled_options.push_back(
+          option.withStrike(option.strike() * tree_spot / spot));
+    }
+
+    std::vector<double> prices =
+        priceBatch(rescaled_options, expiry_years, workspace);
+    for (size_t m = 0; m < spots.size(); ++m) {
+      prices[m] *= spots[m] / tree_spot;
+    }
+    return prices;
+  }
+
+  std::vector<double> priceEuropeanBatch(
+      std::span<const EuropeanPayoff> payoffs,
+      double expiry_years) {
+    return priceEuropeanBatch(payoffs, expiry_years, workspace_);
+  }
+
+  // Prices European options (any mix of EuropeanPayoff) which all expire at
+  // `expiry_years` by forward rather than backward induction: each price is
+  // the dot product of the Arrow-Debreu prices at the expiry with the payoff.
+  // Once the Arrow-Debreu tree is in place (it is cached, see
+  // arrowDebreuTree), this takes O(N) per payoff instead of the O(N^2) of a
+  // backward induction. Early exercise is ignored, as is terminal smoothing.
+  // Returns the prices in the same order as `payoffs`, or zeros if the expiry
+  // is outside the tree.
+  std::vector<double> priceEuropeanBatch(
+      std::span<const EuropeanPayoff> payoffs,
+      double expiry_years,
+      PricingWorkspace& workspace) const {
+    std::vector<double> prices(payoffs.size(), 0.0);
+    auto ti_or = asset_tree_->getTimegrid().getTimeIndexForExpiry(expiry_years);
+    if (ti_or == std::nullopt) {
+      LOG(ERROR) << "Forward induction is impossible for requested expiry "
+                 << expiry_years;
+      return prices;
+    }
+    const int ti = ti_or.value();
+    const std::shared_ptr<const BinomialTree> arrow_debreu_tree =
+        arrowDebreuTree(workspace);
+
+    // State prices are only propagated to the active nodes.
+    const NodeRange active = asset_tree_->activeNodes(ti);
+    workspace.reserve(ti + 1);
+    auto states = workspace.states_.head(active.size());
+    auto state_prices = workspace.state_prices_.head(active.size());
+    asset_tree_->copyTimeslice(ti, active, states);
+    arrow_debreu_tree->copyTimeslice(ti, active, state_prices);
+    for (size_t k = 0; k < payoffs.size(); ++k) {
+      prices[k] = std::visit(
+          [&](const auto& payoff) {
+            return (state_prices * payoff.payoff(states)).sum();
+          },
+          payoffs[k]);
+    }
+    return prices;
+  }
+
+  // Timeslices with fewer nodes than this are not worth splitting across
+  // threads.
+  static constexpr int kDefaultMinParallelRowSize = 4096;
+
+  // Opts into parallel backward induction and Arrow-Debreu propagation:
+  // every node of a timeslice only depends on the adjacent timeslice, so
+  // timeslices of at least `min_parallel_row_size` nodes are split into
+  // blocks, which are processed on `thread_pool` (not owned). Smaller
+  // timeslices stay serial. Pass nullptr to make everything serial again.
+  // Prices do not depend on the number of threads.
+  void setThreadPool(ThreadPool* thread_pool,
+                     int min_parallel_row_size = kDefaultMinParallelRowSize) {
+    thread_pool_ = thread_pool;
+    min_parallel_row_size_ = min_parallel_row_size;
+  }
+
+  // Populated by pricing with BackwardInductionStorage::kFullTree, using the
+  // workspace owned by this derivative.
+  const BinomialTree& binomialTree() const {
+    return workspace_.derivativeTree();
+  }
+
+  std::shared_ptr<const BinomialTree> arrowDebreuTree() {
+    return arrowDebreuTree(workspace_);
+  }
+
+  // The Arrow-Debreu price of every node of the asset tree, i.e. its
+  // discounted risk-neutral probability. This is computed on first use, and
+  // then shared by all the derivatives on the asset tree and curves until one
+  // of them changes (see ArrowDebreuCache). The tree returned is a snapshot,
+  // which later updates leave untouched, so it is safe to read while other
+  // threads price.
+  std::shared_ptr<const BinomialTree> arrowDebreuTree(
+      PricingWorkspace& workspace) const {
+    ArrowDebreuCache& cache = arrowDebreuCache();
+    const ArrowDebreuCache::Inputs inputs{
+        .asset_tree = asset_tree_->version(),
+        .curve = curve_->version(),
+        .foreign_curve = foreignCurve() == nullptr
+                             ? std::nullopt
+                             : std::optional(foreignCurve()->version())};
+    std::lock_guard lock(cache.mutex_);
+    if (cache.inputs_ != inputs) {
+      if (cache.tree_ == nullptr || cache.tree_.use_count() > 1) {
+        cache.tree_ = std::make_shared<BinomialTree>();
+      }
+      updateArrowDebreuPrices(*cache.tree_, workspace);
+      cache.inputs_ = inputs;
+      ++cache.num_updates_;
+    }
+    return cache.tree_;
   }
 
  private:
-  BinomialTree deriv_tree_;
-  BinomialTree arrow_debreu_tree_;
+  BackwardInductionStorage storage_;
+  TerminalSmoothing smoothing_;
+
+  // Used by the methods which do not take a PricingWorkspace.
+  PricingWorkspace workspace_;
+
+  // Not owned. See setThreadPool.
+  ThreadPool* thread_pool_ = nullptr;
+  int min_parallel_row_size_ = kDefaultMinParallelRowSize;
+
+  // Looked up on first use (see arrowDebreuCache) rather than on
+  // construction, since the registry is shared by every thread, and most
+  // derivatives are only built to be priced by backward induction. Copies
+  // look it up again.
+  struct LazyArrowDebreuCache {
+    LazyArrowDebreuCache() = default;
+    LazyArrowDebreuCache(const LazyArrowDebreuCache&) {}
+    LazyArrowDebreuCache& operator=(const LazyArrowDebreuCache&) {
+      std::lock_guard lock(mutex);
+      cache.reset();
+      return *this;
+    }
+
+    std::mutex mutex;
+    std::shared_ptr<ArrowDebreuCache> cache;
+  };
+  mutable LazyArrowDebreuCache arrow_debreu_cache_;
 
  protected:
+  // Currency derivatives additionally depend on the foreign rates curve (see
+  // CurrencyDerivative).
+  SingleAssetDerivative(const BinomialTree* asset_tree,
+                        const RatesCurve* curve,
+                        const RatesCurve* foreign_curve,
+                        BackwardInductionStorage storage,
+                        TerminalSmoothing smoothing)
+      : storage_(storage),
+        smoothing_(smoothing),
+        asset_tree_(asset_tree),
+        curve_(curve),
+        foreign_curve_(foreign_curve) {}
+
   // Not owned. These are underlying securities and general market conditions.
   const BinomialTree* asset_tree_;
   const RatesCurve* curve_;
 
  private:
-  virtual double getUpProbAt(int time_index, int i) const {
-    return asset_tree_->getUpProbAt(*curve_, time_index, i);
+  // Not owned. Null unless this is a CurrencyDerivative.
+  const RatesCurve* foreign_curve_;
+
+  const RatesCurve* foreignCurve() const { return foreign_curve_; }
+
+  // The Arrow-Debreu cache shared by the derivatives on the same asset tree
+  // and curves.
+  ArrowDebreuCache& arrowDebreuCache() const {
+    std::lock_guard lock(arrow_debreu_cache_.mutex);
+    if (arrow_debreu_cache_.cache == nullptr) {
+      arrow_debreu_cache_.cache =
+          ArrowDebreuCache::forInputs(asset_tree_, curve_, foreignCurve());
+    }
+    return *arrow_debreu_cache_.cache;
   }
 
-  double forwardDF(int t) const {
-    const auto& timegrid = asset_tree_->getTimegrid();
-    return curve_->forwardDF(timegrid.time(t), timegrid.time(t + 1));
+  // The asset tree which backward induction runs on: the derivative's own,
+  // unless the workspace has another tree in its place (see priceWithGreeks
+  // with a vol-bumped tree).
+  const BinomialTree& assetTree(const PricingWorkspace& workspace) const {
+    return workspace.asset_tree_override_ != nullptr
+               ? *workspace.asset_tree_override_
+               : *asset_tree_;
+  }
+
+  void updateTransitionTable(PricingWorkspace& workspace) const {
+    workspace.transitions_.update(
+        assetTree(workspace), *curve_, foreignCurve());
+  }
+
+  static double forwardDF(int t, const PricingWorkspace& workspace) {
+    return workspace.transitions_.forwardDF(t);
+  }
+
+  void updateArrowDebreuPrices(BinomialTree& arrow_debreu_tree,
+                               PricingWorkspace& workspace) const {
+    // Reuses the storage of the previous Arrow-Debreu tree, if any. Nodes
+    // outside the truncation band must stay at zero, so every node is reset.
+    arrow_debreu_tree.reshapeLike(*asset_tree_);
+    arrow_debreu_tree.setZeroAfterIndex(0);
+    updateTransitionTable(workspace);
+    const BinomialTransitionTable& transitions = workspace.transitions_;
+    arrow_debreu_tree.setValue(0, 0, 1.0);
+    workspace.reserve(arrow_debreu_tree.numTimesteps() + 1);
+
+    // In a truncated tree, the state prices are only propagated between
+    // active nodes, and left at zero elsewhere. Each timeslice is computed
+    // into workspace.state_prices_ (in parallel blocks, see setThreadPool)
+    // and then written into the tree at once, so that the tree is only
+    // modified by this thread.
+    for (int ti = 1; ti < arrow_debreu_tree.numTimesteps(); ++ti) {
+      const NodeRange prev_active = asset_tree_->activeNodes(ti - 1);
+      const NodeRange active = asset_tree_->activeNodes(ti);
+      forEachNodeBlock(active, [&](NodeRange nodes) {
+        for (int i = nodes.first; i <= nodes.last; ++i) {
+          const bool has_down = prev_active.contains(i - 1);
+          const bool has_up = prev_active.contains(i);
+          double prev_down =
+              has_down ? arrow_debreu_tree.nodeValue(ti - 1, i - 1) : 0;
+          double prev_up =
+              has_up ? arrow_debreu_tree.nodeValue(ti - 1, i) : 0;
+
+          // It's necessary to retrieve transition probabilities from
+          // different nodes in case of local vol.
+          double q_prev_down =
+              has_down ? transitions.upProb(*asset_tree_, ti - 1, i - 1) : 0;
+          double q_prev_up =
+              has_up ? transitions.upProb(*asset_tree_, ti - 1, i) : 0;
+
+          workspace.state_prices_[i] =
+              transitions.forwardDF(ti - 1) *
+              (q_prev_down * prev_down + (1 - q_prev_up) * prev_up);
+        }
+      });
+      arrow_debreu_tree.setTimeslice(
+          ti,
+          active,
+          workspace.state_prices_.segment(active.first, active.size()));
+    }
+  }
+
+  // Derivative values at nodes (t, i) for t <= 2, from which the tree Greeks
+  // are computed.
+  using RootTimeslices = Eigen::Array33d;
+
+  // Calls fn(block) for disjoint blocks of nodes which together make up
+  // `nodes`. These run in parallel if there is a thread pool and `nodes` is
+  // wide enough (see setThreadPool); otherwise fn is called once for all of
+  // `nodes`.
+  template <typename FnT>
+  void forEachNodeBlock(NodeRange nodes, FnT&& fn) const {
+    if (thread_pool_ == nullptr || thread_pool_->numThreads() == 1 ||
+        nodes.size() < min_parallel_row_size_) {
+      fn(nodes);
+      return;
+    }
+    // A few blocks per thread balance the load. Block sizes are multiples of
+    // a cache line's worth of doubles, to limit false sharing.
+    constexpr int kBlockAlignment = 8;
+    const int num_blocks = 4 * thread_pool_->numThreads();
+    const int block_size =
+        (nodes.size() + num_blocks * kBlockAlignment - 1) /
+        (num_blocks * kBlockAlignment) * kBlockAlignment;
+    thread_pool_->parallelFor(
+        (nodes.size() + block_size - 1) / block_size, [&](int block) {
+          const int first = nodes.first + block * block_size;
+          fn(NodeRange{first, std::min(nodes.last, first + block_size - 1)});
+        });
+  }
+
+  // Copies the materialized asset states at ti into workspace.states_ (at
+  // their node indices).
+  void copyMaterializedStates(int ti, PricingWorkspace& workspace) const {
+    const BinomialTree& asset_tree = assetTree(workspace);
+    const NodeRange stored = asset_tree.materializedNodes(ti);
+    asset_tree.copyTimeslice(
+        ti, stored, workspace.states_.segment(stored.first, stored.size()));
+  }
+
+  // Moves the workspace from time index ti + 1 to ti: the asset states at
+  // ti + 1 become next_states_, and the states at ti (and the
+  // up-probabilities out of the active nodes) are computed.
+  void stepBackTimeslice(int ti, PricingWorkspace& workspace) const {
+    workspace.states_.swap(workspace.next_states_);
+    copyMaterializedStates(ti, workspace);
+    const NodeRange active = assetTree(workspace).activeNodes(ti);
+    computeUpProbs(ti, active, workspace);
+  }
+
+  // The same, for some of the active nodes only, once next_states_ is in
+  // place.
+  void stepBackNodes(int ti,
+                     NodeRange nodes,
+                     PricingWorkspace& workspace) const {
+    assetTree(workspace).copyTimeslice(
+        ti, nodes, workspace.states_.segment(nodes.first, nodes.size()));
+    computeUpProbs(ti, nodes, workspace);
+  }
+
+  void computeUpProbs(int ti,
+                      NodeRange nodes,
+                      PricingWorkspace& workspace) const {
+    workspace.up_probs_.segment(nodes.first, nodes.size()) =
+        workspace.transitions_.upProbs(
+            ti,
+            workspace.states_.segment(nodes.first, nodes.size()),
+            workspace.next_states_.segment(nodes.first, nodes.size() + 1));
+  }
+
+  // In a truncated tree, sets the boundary nodes on either side of the
+  // active nodes at ti to the discounted payoff at the forward (and, for
+  // early exercise, no less than the intrinsic value), which the option
+  // value tends to far from the centre of the band.
+  //
+  // Far from the centre need not be far from a barrier, though, so options
+  // with a barrier (see BarrierOption) take their closed-form value until
+  // expiry instead, under the vol implied by the spacing of the nodes.
+  template <typename OptionEvaluatorT, typename CurrT>
+  void fillTruncationBoundary(const OptionEvaluatorT& option_evaluator,
+                              int ti,
+                              int ti_final,
+                              CurrT&& curr,
+                              const PricingWorkspace& workspace) const {
+    const BinomialTree& asset_tree = assetTree(workspace);
+    if (!asset_tree.isTruncated()) {
+      return;
+    }
+    const NodeRange active = asset_tree.activeNodes(ti);
+    const NodeRange stored = asset_tree.materializedNodes(ti);
+    const double df = workspace.transitions_.forwardDF(ti, ti_final);
+    const double growth = workspace.transitions_.growthFactor(ti, ti_final);
+    const Timegrid& timegrid = asset_tree.getTimegrid();
+    const double t = timegrid.time(ti_final) - timegrid.time(ti);
+    for (int i : {stored.first, stored.last}) {
+      if (active.contains(i)) {
+        continue;
+      }
+      const auto state = workspace.states_.segment(i, 1);
+      auto value = curr.segment(i, 1);
+      if constexpr (requires { option_evaluator.barrier(); }) {
+        // Adjacent nodes are two moves of vol * sqrt(dt) apart.
+        const int neighbour = i < active.first ? active.first : active.last;
+        const Eigen::Array<double, 1, 1> vol(
+            std::abs(std::log(workspace.states_[neighbour] / state[0])) /
+            (2 * std::sqrt(timegrid.dt(ti))));
+        const double r = -std::log(df) / t;
+        const double div = r - std::log(growth) / t;
+        option_evaluator.blackScholesTimeslice(state, vol, t, r, div, value);
+      } else {
+        value = df * option_evaluator.payoff(state * growth);
+      }
+      if (option_evaluator.hasEarlyExercise()) {
+        value = value.max(option_evaluator.payoff(state));
+      }
+      knockOut(option_evaluator, state, value);
+    }
+  }
+
+  // Zeroes the `values` at the nodes which evaluators with a barrier (see
+  // BarrierOption) knock out. A no-op for any other evaluator.
+  template <typename OptionEvaluatorT, typename StatesT, typename ValuesT>
+  static void knockOut(const OptionEvaluatorT& option_evaluator,
+                       const StatesT& states,
+                       ValuesT&& values) {
+    if constexpr (requires { option_evaluator.knockOut(states, values); }) {
+      option_evaluator.knockOut(states, values);
+    }
   }
 
-  void updateArrowDebreuPrices() {
-    arrow_debreu_tree_.setValue(0, 0, 1.0);
+  // Overwrites the active nodes of `curr` with the Black-Scholes values over
+  // the step from ti to ti + 1 (see TerminalSmoothing::kBlackScholes),
+  // followed by early exercise if applicable. Expects the workspace to have
+  // been stepped back to ti.
+  template <typename OptionEvaluatorT, typename CurrT>
+  void smoothTimeslice(const OptionEvaluatorT& option_evaluator,
+                       int ti,
+                       CurrT&& curr,
+                       PricingWorkspace& workspace) const {
+    const BinomialTree& asset_tree = assetTree(workspace);
+    const double dt = asset_tree.getTimegrid().dt(ti);
+    const double r = -std::log(forwardDF(ti, workspace)) / dt;
+    const double div =
+        r - std::log(workspace.transitions_.growthFactor(ti)) / dt;
+    const NodeRange active = asset_tree.activeNodes(ti);
+    const int n = active.size();
+    const auto states = workspace.states_.segment(active.first, n);
+    const auto next_states =
+        workspace.next_states_.segment(active.first, n + 1);
+    auto vols = workspace.vols_.head(n);
+    vols = (next_states.tail(n) / next_states.head(n)).log() /
+           (2 * std::sqrt(dt));
+    auto active_curr = curr.segment(active.first, n);
+    option_evaluator.blackScholesTimeslice(
+        states, vols, dt, r, div, active_curr);
+    if (option_evaluator.hasEarlyExercise()) {
+      active_curr = active_curr.max(option_evaluator.payoff(states));
+    }
+    knockOut(option_evaluator, states, active_curr);
+  }
 
-    for (int ti = 1; ti < arrow_debreu_tree_.numTimesteps(); ++ti) {
-      for (int i = 0; i <= ti; ++i) {
-        double prev_down =
-            i == 0 ? 0 : arrow_debreu_tree_.nodeValue(ti - 1, i - 1);
-        double prev_up = i == ti ? 0 : arrow_debreu_tree_.nodeValue(ti - 1, i);
+  // Rolls the derivative values at ti + 1 (`next`) back to ti (`curr`) across
+  // all the active nodes at once (or in parallel blocks of them, see
+  // setThreadPool), so that the compiler can vectorise it. Expects
+  // workspace.states_ to hold the asset states at ti + 1.
+  template <typename OptionEvaluatorT, typename NextT, typename CurrT>
+  void rollbackTimeslice(const OptionEvaluatorT& option_evaluator,
+                         int ti,
+                         int ti_final,
+                         const NextT& next,
+                         CurrT&& curr,
+                         PricingWorkspace& workspace) const {
+    const BinomialTree& asset_tree = assetTree(workspace);
+    if (smoothing_ == TerminalSmoothing::kBlackScholes && ti + 1 == ti_final) {
+      stepBackTimeslice(ti, workspace);
+      fillTruncationBoundary(option_evaluator, ti, ti_final, curr, workspace);
+      smoothTimeslice(option_evaluator, ti, curr, workspace);
+      return;
+    }
 
-        // It's necessary to retrieve transition probabilities from different
-        // nodes in case of local vol.
-        double q_prev_down = i == 0 ? 0 : getUpProbAt(ti - 1, i - 1);
-        double q_prev_up = i == ti ? 0 : getUpProbAt(ti - 1, i);
+    workspace.states_.swap(workspace.next_states_);
+    const NodeRange active = asset_tree.activeNodes(ti);
+    forEachNodeBlock(active, [&](NodeRange nodes) {
+      rollbackNodes(option_evaluator, ti, nodes, next, curr, workspace);
+    });
 
-        double ad_price = forwardDF(ti - 1) *
-                          (q_prev_down * prev_down + (1 - q_prev_up) * prev_up);
-        arrow_debreu_tree_.setValue(ti, i, ad_price);
+    // The boundary nodes of a truncated tree only need their states.
+    const NodeRange stored = asset_tree.materializedNodes(ti);
+    for (int i : {stored.first, stored.last}) {
+      if (!active.contains(i)) {
+        asset_tree.copyTimeslice(
+            ti, NodeRange{i, i}, workspace.states_.segment(i, 1));
       }
     }
+    fillTruncationBoundary(option_evaluator, ti, ti_final, curr, workspace);
   }
 
+  // The part of rollbackTimeslice which applies to the active `nodes` at ti
+  // on their own. Expects workspace.next_states_ to hold the asset states at
+  // ti + 1, and computes the states and up-probabilities of `nodes` on the
+  // way.
+  template <typename OptionEvaluatorT, typename NextT, typename CurrT>
+  void rollbackNodes(const OptionEvaluatorT& option_evaluator,
+                     int ti,
+                     NodeRange nodes,
+                     const NextT& next,
+                     CurrT& curr,
+                     PricingWorkspace& workspace) const {
+    const int n = nodes.size();
+    stepBackNodes(ti, nodes, workspace);
+    const auto states = workspace.states_.segment(nodes.first, n);
+    const auto p = workspace.up_probs_.segment(nodes.first, n);
+    auto nodes_curr = curr.segment(nodes.first, n);
+    nodes_curr =
+        forwardDF(ti, workspace) * (next.segment(nodes.first + 1, n) * p +
+                                    next.segment(nodes.first, n) * (1 - p));
+    if (option_evaluator.hasEarlyExercise()) {
+      nodes_curr = nodes_curr.max(option_evaluator.payoff(states));
+    }
+    knockOut(option_evaluator, states, nodes_curr);
+  }
+
+  // Populates the derivative tree of the workspace and returns the value at
+  // the root. The values are computed in double precision, and only rounded to
+  // the precision of the tree (see StoragePrecision) when stored.
   template <typename OptionEvaluatorT>
-  void runBackwardInduction(const OptionEvaluatorT& option_evaluator,
-                            double expiry_years) {
+  double runBackwardInduction(const OptionEvaluatorT& option_evaluator,
+                              double expiry_years,
+                              PricingWorkspace& workspace,
+                              RootTimeslices* root_values = nullptr) const {
+    const BinomialTree& asset_tree = assetTree(workspace);
     auto ti_final_or =
-        deriv_tree_.getTimegrid().getTimeIndexForExpiry(expiry_years);
+        asset_tree.getTimegrid().getTimeIndexForExpiry(expiry_years);
     if (ti_final_or == std::nullopt) {
       LOG(ERROR) << "Backward induction is impossible for requested expiry "
                  << expiry_years;
-      return;
+      return 0.0;
+    }
+    BinomialTree& deriv_tree = workspace.deriv_tree_;
+    deriv_tree.reshapeLike(asset_tree);
+    deriv_tree.setZeroAfterIndex(ti_final_or.value());
+    return runRollingBackwardInduction(
+        option_evaluator, expiry_years, workspace, root_values, &deriv_tree);
+  }
+
+  // Backward induction in which only the timeslice at ti + 1 is retained
+  // while computing the one at ti. Returns the value at the root. The
+  // timeslices at ti <= 2 are copied into `root_values` if requested, and
+  // every timeslice into `deriv_tree` if requested.
+  template <typename OptionEvaluatorT>
+  double runRollingBackwardInduction(
+      const OptionEvaluatorT& option_evaluator,
+      double expiry_years,
+      PricingWorkspace& workspace,
+      RootTimeslices* root_values = nullptr,
+      BinomialTree* deriv_tree = nullptr) const {
+    const BinomialTree& asset_tree = assetTree(workspace);
+    auto ti_final_or =
+        asset_tree.getTimegrid().getTimeIndexForExpiry(expiry_years);
+    if (ti_final_or == std::nullopt) {
+      LOG(ERROR) << "Backward induction is impossible for requested expiry "
+                 << expiry_years;
+      return 0.0;
     }
     int ti_final = ti_final_or.value();
-    deriv_tree_.setZeroAfterIndex(ti_final);
+    updateTransitionTable(workspace);
+    workspace.reserve(ti_final + 1);
 
+    copyMaterializedStates(ti_final, workspace);
+    const NodeRange stored = asset_tree.materializedNodes(ti_final);
+    workspace.next_values_.col(0).segment(stored.first, stored.size()) =
+        option_evaluator.payoff(
+            workspace.states_.segment(stored.first, stored.size()));
     for (int ti = ti_final; ti >= 0; --ti) {
-      for (int i = 0; i <= ti; ++i) {
-        const double up_prob = getUpProbAt(ti, i);
-        const double fwd_df = forwardDF(ti);
-        const double deriv_value_at_node = option_evaluator(
-            deriv_tree_, *asset_tree_, ti, i, ti_final, up_prob, fwd_df);
-        deriv_tree_.setValue(ti, i, deriv_value_at_node);
+      if (ti < ti_final) {
+        rollbackTimeslice(option_evaluator,
+                          ti,
+                          ti_final,
+                          workspace.next_values_.col(0).head(ti + 2),
+                          workspace.curr_values_.col(0).head(ti + 1),
+                          workspace);
+        workspace.next_values_.swap(workspace.curr_values_);
+      }
+      if (root_values != nullptr && ti <= 2) {
+        root_values->row(ti).head(ti + 1) =
+            workspace.next_values_.col(0).head(ti + 1).transpose();
+      }
+      if (deriv_tree != nullptr) {
+        const NodeRange nodes = asset_tree.materializedNodes(ti);
+        deriv_tree->setTimeslice(
+            ti,
+            nodes,
+            workspace.next_values_.col(0).segment(nodes.first, nodes.size()));
       }
     }
+    return workspace.next_values_(0, 0);
   }
 };
 
 class CurrencyDerivative : public SingleAssetDerivative {
  public:
-  CurrencyDerivative(const BinomialTree* asset_tree,
-                     const RatesCurve* domestic_curve,
-                     const RatesCurve* foreign_curve)
-      : SingleAssetDerivative(asset_tree, domestic_curve),
-        foreign_curve_(foreign_curve) {}
-
- private:
-  const RatesCurve* foreign_curve_;
-
-  double getUpProbAt(int time_index, int i) const override {
-    return this->asset_tree_->getUpProbAt(
-        *this->curve_, *foreign_curve_, time_index, i);
-  }
+  CurrencyDerivative(
+      const BinomialTree* asset_tree,
+      const RatesCurve* domestic_curve,
+      const RatesCurve* foreign_curve,
+      BackwardInductionStorage storage = BackwardInductionStorage::kFullTree,
+      TerminalSmoothing smoothing = TerminalSmoothing::kNone)
+      : SingleAssetDerivative(
+            asset_tree, domestic_curve, foreign_curve, storage, smoothing) {}
 };
 
 }  // namespace smileexplorer
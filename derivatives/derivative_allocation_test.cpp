@@ -0,0 +1,122 @@
+// Built with EIGEN_RUNTIME_NO_MALLOC and without NDEBUG (see BUILD.bazel), so
+// that Eigen asserts on heap allocations while they are forbidden (see
+// Eigen::internal::set_is_malloc_allowed).
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "derivatives/derivative.h"
+#include "rates/zero_curve.h"
+#include "trees/binomial_tree.h"
+#include "trees/propagators.h"
+#include "trees/stochastic_tree_model.h"
+#include "volatility/volatility.h"
+
+// Counts every other heap allocation (e.g. by std::vector), which Eigen's
+// check does not see. The array forms call these by default.
+namespace {
+std::atomic<int> num_allocations = 0;
+}  // namespace
+
+// GCC cannot tell that these replace the global operators, so it warns that
+// they free memory from operator new.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size) {
+  ++num_allocations;
+  if (void* ptr = std::malloc(size == 0 ? 1 : size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+// Over-aligned types (e.g. fixed-size vectorizable Eigen types).
+// std::aligned_alloc requires the size to be a multiple of the alignment.
+void* operator new(std::size_t size, std::align_val_t alignment) {
+  ++num_allocations;
+  const auto align = static_cast<std::size_t>(alignment);
+  const std::size_t aligned_size =
+      (std::max<std::size_t>(size, 1) + align - 1) / align * align;
+  if (void* ptr = std::aligned_alloc(align, aligned_size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept {
+  std::free(ptr);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace smileexplorer {
+namespace {
+
+// Forbids heap allocations for as long as it lives, and counts those which
+// are made anyway.
+class NoAllocationScope {
+ public:
+  NoAllocationScope() : num_allocations_before_(num_allocations) {
+    Eigen::internal::set_is_malloc_allowed(false);
+  }
+  ~NoAllocationScope() { Eigen::internal::set_is_malloc_allowed(true); }
+
+  int numAllocations() const {
+    return num_allocations - num_allocations_before_;
+  }
+
+ private:
+  int num_allocations_before_;
+};
+
+TEST(DerivativeAllocationTest, WarmWorkspacesDoNotAllocate) {
+  StochasticTreeModel asset(BinomialTree(1.1, 1 / 500.), CRRPropagator(100));
+  asset.forwardPropagate(Volatility(FlatVol(0.2)));
+  StochasticTreeModel bumped_asset(BinomialTree(1.1, 1 / 500.),
+                                   CRRPropagator(100));
+  bumped_asset.forwardPropagate(Volatility(FlatVol(0.21)));
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  const VanillaOption american_put(
+      100, OptionPayoff::Put, ExerciseStyle::American);
+
+  for (auto storage : {BackwardInductionStorage::kFullTree,
+                       BackwardInductionStorage::kRollingTimeslices}) {
+    const SingleAssetDerivative deriv(&asset.binomialTree(),
+                                      &curve,
+                                      storage,
+                                      TerminalSmoothing::kBlackScholes);
+    PricingWorkspace workspace;
+    const double price = deriv.price(american_put, 1.0, workspace);
+
+    // Shorter expiries fit in the same workspace, as does a vol-bumped tree.
+    double repriced;
+    double shorter_expiry_price;
+    TreeGreeks greeks;
+    {
+      NoAllocationScope no_allocations;
+      repriced = deriv.price(american_put, 1.0, workspace);
+      shorter_expiry_price = deriv.price(american_put, 0.5, workspace);
+      greeks = deriv.priceWithGreeks(
+          american_put, 1.0, bumped_asset.binomialTree(), 0.01, workspace);
+      EXPECT_EQ(0, no_allocations.numAllocations());
+    }
+
+    EXPECT_EQ(price, repriced);
+    EXPECT_LT(shorter_expiry_price, price);
+    EXPECT_EQ(price, greeks.price);
+    EXPECT_GT(greeks.vega.value(), 0.0);
+  }
+}
+
+}  // namespace
+}  // namespace smileexplorer
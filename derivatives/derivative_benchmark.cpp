@@ -0,0 +1,261 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <optional>
+#include <vector>
+
+#include "derivatives/derivative.h"
+#include "derivatives/fixed_tree_derivative.h"
+#include "rates/zero_curve.h"
+#include "trees/binomial_transition_table.h"
+#include "trees/binomial_tree.h"
+#include "trees/fixed_binomial_tree.h"
+#include "trees/propagators.h"
+#include "trees/stochastic_tree_model.h"
+#include "volatility/volatility.h"
+
+namespace smileexplorer {
+namespace {
+
+constexpr double kExpiry = 1.0;
+
+// A one-year CRR tree with `num_steps` steps until expiry. (The tree is made
+// slightly longer than the expiry, since the final timeslice is left empty by
+// forward propagation.)
+StochasticTreeModel<CRRPropagator> createAsset(
+    int num_steps, std::optional<double> truncation_std_devs = std::nullopt) {
+  const double dt = kExpiry / num_steps;
+  BinomialTree tree(kExpiry + 2 * dt, dt);
+  if (truncation_std_devs.has_value()) {
+    tree.truncate(truncation_std_devs.value());
+  }
+  StochasticTreeModel<CRRPropagator> asset(tree, CRRPropagator(100));
+  asset.forwardPropagate(Volatility(FlatVol(0.2)));
+  return asset;
+}
+
+// A scalar node-by-node recursion over the same BinomialTransitionTable as
+// SingleAssetDerivative uses, i.e. the backward induction before it was
+// vectorised over whole timeslices: one up-probability and one scalar update
+// per node, with no curve lookups.
+double perNodeBackwardInduction(const BinomialTree& asset_tree,
+                                const BinomialTransitionTable& transitions,
+                                double strike,
+                                std::vector<double>& values) {
+  const auto& timegrid = asset_tree.getTimegrid();
+  const int ti_final = timegrid.getTimeIndexForExpiry(kExpiry).value();
+  values.resize(ti_final + 1);
+  for (int i = 0; i <= ti_final; ++i) {
+    values[i] = std::max(0.0, strike - asset_tree.nodeValue(ti_final, i));
+  }
+  for (int ti = ti_final - 1; ti >= 0; --ti) {
+    const double fwd_df = transitions.forwardDF(ti);
+    for (int i = 0; i <= ti; ++i) {
+      const double p = transitions.upProb(asset_tree, ti, i);
+      const double continuation =
+          fwd_df * (values[i + 1] * p + values[i] * (1 - p));
+      values[i] = std::max(continuation,
+                           std::max(0.0, strike - asset_tree.nodeValue(ti, i)));
+    }
+  }
+  return values[0];
+}
+
+void BM_PerNodeBackwardInduction(benchmark::State& state) {
+  const auto asset = createAsset(state.range(0));
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  BinomialTransitionTable transitions;
+  transitions.update(asset.binomialTree(), curve);
+  std::vector<double> values;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(perNodeBackwardInduction(
+        asset.binomialTree(), transitions, 100, values));
+  }
+}
+
+void BM_TimesliceKernelBackwardInduction(benchmark::State& state) {
+  const auto asset = createAsset(state.range(0));
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  SingleAssetDerivative deriv(&asset.binomialTree(),
+                              &curve,
+                              BackwardInductionStorage::kRollingTimeslices);
+  const VanillaOption american_put(
+      100, OptionPayoff::Put, ExerciseStyle::American);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(deriv.price(american_put, kExpiry));
+  }
+}
+
+void BM_KnockOutBackwardInduction(benchmark::State& state) {
+  const auto asset = createAsset(state.range(0));
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  SingleAssetDerivative deriv(&asset.binomialTree(),
+                              &curve,
+                              BackwardInductionStorage::kRollingTimeslices);
+  const BarrierOption down_and_out_put(
+      VanillaOption(100, OptionPayoff::Put, ExerciseStyle::American),
+      90,
+      BarrierType::kDownAndOut);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(deriv.price(down_and_out_put, kExpiry));
+  }
+}
+
+void BM_TruncatedBackwardInduction(benchmark::State& state) {
+  const auto asset = createAsset(state.range(0), 8);
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  SingleAssetDerivative deriv(&asset.binomialTree(),
+                              &curve,
+                              BackwardInductionStorage::kRollingTimeslices);
+  const VanillaOption american_put(
+      100, OptionPayoff::Put, ExerciseStyle::American);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(deriv.price(american_put, kExpiry));
+  }
+}
+
+void BM_ParallelBackwardInduction(benchmark::State& state) {
+  const auto asset = createAsset(state.range(0));
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  SingleAssetDerivative deriv(&asset.binomialTree(),
+                              &curve,
+                              BackwardInductionStorage::kRollingTimeslices);
+  ThreadPool pool;
+  deriv.setThreadPool(&pool);
+  const VanillaOption american_put(
+      100, OptionPayoff::Put, ExerciseStyle::American);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(deriv.price(american_put, kExpiry));
+  }
+}
+
+std::vector<VanillaOption> createOptionChain() {
+  std::vector<VanillaOption> chain;
+  for (int k = 0; k < 40; ++k) {
+    chain.emplace_back(80 + k, OptionPayoff::Put, ExerciseStyle::American);
+  }
+  return chain;
+}
+
+void BM_OptionChainOneByOne(benchmark::State& state) {
+  const auto asset = createAsset(state.range(0));
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  SingleAssetDerivative deriv(&asset.binomialTree(),
+                              &curve,
+                              BackwardInductionStorage::kRollingTimeslices);
+  const auto chain = createOptionChain();
+  for (auto _ : state) {
+    for (const auto& option : chain) {
+      benchmark::DoNotOptimize(deriv.price(option, kExpiry));
+    }
+  }
+}
+
+void BM_OptionChainBatch(benchmark::State& state) {
+  const auto asset = createAsset(state.range(0));
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  SingleAssetDerivative deriv(&asset.binomialTree(),
+                              &curve,
+                              BackwardInductionStorage::kRollingTimeslices);
+  const auto chain = createOptionChain();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(deriv.priceBatch(chain, kExpiry));
+  }
+}
+
+void BM_EuropeanChainBatch(benchmark::State& state) {
+  const auto asset = createAsset(state.range(0));
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  SingleAssetDerivative deriv(&asset.binomialTree(),
+                              &curve,
+                              BackwardInductionStorage::kRollingTimeslices);
+  std::vector<VanillaOption> chain;
+  for (int k = 0; k < 40; ++k) {
+    chain.emplace_back(80 + k, OptionPayoff::Put);
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(deriv.priceBatch(chain, kExpiry));
+  }
+}
+
+void BM_EuropeanChainForwardInduction(benchmark::State& state) {
+  const auto asset = createAsset(state.range(0));
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  SingleAssetDerivative deriv(&asset.binomialTree(), &curve);
+  std::vector<EuropeanPayoff> chain;
+  for (int k = 0; k < 40; ++k) {
+    chain.push_back(VanillaOption(80 + k, OptionPayoff::Put));
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(deriv.priceEuropeanBatch(chain, kExpiry));
+  }
+}
+
+// Intraday options on a 32-step tree.
+constexpr int kSmallTreeSteps = 32;
+constexpr double kIntradayExpiry = 1 / 365.;
+
+void BM_SmallTreeOptionChain(benchmark::State& state) {
+  constexpr double dt = kIntradayExpiry / kSmallTreeSteps;
+  StochasticTreeModel asset(BinomialTree(kIntradayExpiry + 2 * dt, dt),
+                            CRRPropagator(100));
+  asset.forwardPropagate(Volatility(FlatVol(0.2)));
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  SingleAssetDerivative deriv(&asset.binomialTree(),
+                              &curve,
+                              BackwardInductionStorage::kRollingTimeslices);
+  const auto chain = createOptionChain();
+  for (auto _ : state) {
+    for (const auto& option : chain) {
+      benchmark::DoNotOptimize(deriv.price(option, kIntradayExpiry));
+    }
+  }
+}
+
+void BM_FixedSizeTreeOptionChain(benchmark::State& state) {
+  FixedBinomialTree<kSmallTreeSteps> tree(kIntradayExpiry);
+  tree.forwardPropagate(CRRPropagator(100), Volatility(FlatVol(0.2)));
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  const FixedTreeDerivative<kSmallTreeSteps> deriv(tree, curve);
+  const auto chain = createOptionChain();
+  for (auto _ : state) {
+    for (const auto& option : chain) {
+      benchmark::DoNotOptimize(deriv.price(option));
+    }
+  }
+}
+
+BENCHMARK(BM_PerNodeBackwardInduction)
+    ->Arg(1000)
+    ->Arg(5000)
+    ->Arg(20000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_TimesliceKernelBackwardInduction)
+    ->Arg(1000)
+    ->Arg(5000)
+    ->Arg(20000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_KnockOutBackwardInduction)
+    ->Arg(1000)
+    ->Arg(5000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_ParallelBackwardInduction)
+    ->Arg(5000)
+    ->Arg(20000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_TruncatedBackwardInduction)
+    ->Arg(1000)
+    ->Arg(5000)
+    ->Arg(20000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_OptionChainOneByOne)->Arg(1000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_OptionChainBatch)->Arg(1000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_EuropeanChainBatch)->Arg(1000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_EuropeanChainForwardInduction)
+    ->Arg(1000)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SmallTreeOptionChain)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_FixedSizeTreeOptionChain)->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+}  // namespace smileexplorer
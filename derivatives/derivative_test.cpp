@@ -2,6 +2,8 @@
 
 #include <gtest/gtest.h>
 
+#include <thread>
+
 #include "rates/zero_curve.h"
 #include "trees/binomial_tree.h"
 #include "trees/propagators.h"
@@ -65,6 +67,17 @@ struct DermanExampleVol {
   }
 };
 
+// Local vol trees with steep skews break down far from the spine (even with
+// reasonably large timesteps), so a milder skew is used to compare truncated
+// and full trees.
+struct MildSkewLocalVol {
+  static constexpr VolSurfaceFnType type =
+      VolSurfaceFnType::kTimeInvariantSkewSmile;
+  double operator()(double s) const {
+    return std::clamp(0.2 - 0.1 * (s - 100) / 100, 0.1, 0.3);
+  }
+};
+
 // TODO Move this out of this module.
 TEST(DerivativeTest, Derman_VolSmile_13_6) {
   // This is the final part of this textbook end-of-chapter question.
@@ -131,6 +144,889 @@ TEST(DerivativeTest, CurrencyOptionTreePricing) {
   double amer_option_price = fxderiv.price(
       VanillaOption(0.6, OptionPayoff::Call, ExerciseStyle::American), 0.25);
   EXPECT_NEAR(0.01888, amer_option_price, 0.00001);
+
+  CurrencyDerivative rolling_fxderiv(
+      &asset.binomialTree(),
+      &domestic_curve,
+      &foreign_curve,
+      BackwardInductionStorage::kRollingTimeslices);
+  EXPECT_DOUBLE_EQ(
+      amer_option_price,
+      rolling_fxderiv.price(
+          VanillaOption(0.6, OptionPayoff::Call, ExerciseStyle::American),
+          0.25));
+}
+
+TEST(DerivativeTest, RollingTimeslicesMatchFullTree) {
+  StochasticTreeModel<CRRPropagator> asset(BinomialTree(1.1, 1 / 100.),
+                                           CRRPropagator(100));
+  asset.forwardPropagate(Volatility(FlatVol(0.2)));
+  ZeroSpotCurve curve({1.0, 10.0}, {0.05, 0.05});
+
+  SingleAssetDerivative full_tree_deriv(&asset.binomialTree(), &curve);
+  SingleAssetDerivative rolling_deriv(
+      &asset.binomialTree(),
+      &curve,
+      BackwardInductionStorage::kRollingTimeslices);
+
+  for (const auto& option :
+       {VanillaOption(95, OptionPayoff::Call),
+        VanillaOption(105, OptionPayoff::Put),
+        VanillaOption(95, OptionPayoff::Call, ExerciseStyle::American),
+        VanillaOption(105, OptionPayoff::Put, ExerciseStyle::American)}) {
+    EXPECT_DOUBLE_EQ(full_tree_deriv.price(option, 1.0),
+                     rolling_deriv.price(option, 1.0));
+  }
+
+  // The derivative tree is never populated in rolling mode.
+  EXPECT_EQ(-1, rolling_deriv.binomialTree().numTimesteps());
+}
+
+TEST(DerivativeTest, TreeGreeksApproxEqualBSM) {
+  constexpr double kVol = 0.2;
+  constexpr double kRate = 0.05;
+  StochasticTreeModel<CRRPropagator> asset(BinomialTree(1.1, 1 / 360.),
+                                           CRRPropagator(100));
+  asset.forwardPropagate(Volatility(FlatVol(kVol)));
+  StochasticTreeModel<CRRPropagator> bumped_asset(BinomialTree(1.1, 1 / 360.),
+                                                  CRRPropagator(100));
+  bumped_asset.forwardPropagate(Volatility(FlatVol(kVol + 0.01)));
+  ZeroSpotCurve curve({1.0, 10.0}, {kRate, kRate});
+
+  SingleAssetDerivative full_tree_deriv(&asset.binomialTree(), &curve);
+  SingleAssetDerivative rolling_deriv(
+      &asset.binomialTree(),
+      &curve,
+      BackwardInductionStorage::kRollingTimeslices);
+
+  for (auto payoff : {OptionPayoff::Call, OptionPayoff::Put}) {
+    const VanillaOption option(105, payoff);
+    const auto greeks = full_tree_deriv.priceWithGreeks(
+        option, 1.0, bumped_asset.binomialTree(), 0.01);
+    EXPECT_DOUBLE_EQ(full_tree_deriv.price(option, 1.0), greeks.price);
+
+    const auto bsm_greek = [&](Greeks greek) {
+      return option.blackScholesGreek(100, kVol, 1.0, kRate, 0.0, greek);
+    };
+    EXPECT_NEAR(bsm_greek(Greeks::Delta), greeks.delta, 2e-3);
+    EXPECT_NEAR(bsm_greek(Greeks::Gamma), greeks.gamma, 2e-4);
+    EXPECT_NEAR(bsm_greek(Greeks::Theta), greeks.theta, 2e-4);
+    ASSERT_TRUE(greeks.vega.has_value());
+    EXPECT_NEAR(bsm_greek(Greeks::Vega), greeks.vega.value(), 5e-3);
+
+    // Both storage modes see the same timeslices near the root.
+    const auto rolling_greeks = rolling_deriv.priceWithGreeks(option, 1.0);
+    EXPECT_DOUBLE_EQ(greeks.price, rolling_greeks.price);
+    EXPECT_DOUBLE_EQ(greeks.delta, rolling_greeks.delta);
+    EXPECT_DOUBLE_EQ(greeks.gamma, rolling_greeks.gamma);
+    EXPECT_DOUBLE_EQ(greeks.theta, rolling_greeks.theta);
+    EXPECT_FALSE(rolling_greeks.vega.has_value());
+  }
+
+  // The middle node at time index 2 of a Jarrow-Rudd tree has drifted away
+  // from the spot, which theta must not mistake for the passage of time.
+  StochasticTreeModel<JarrowRuddPropagator> jr_asset(
+      BinomialTree(1.1, 1 / 360.), JarrowRuddPropagator(kRate, 100));
+  jr_asset.forwardPropagate(Volatility(FlatVol(kVol)));
+  SingleAssetDerivative jr_deriv(&jr_asset.binomialTree(), &curve);
+  for (auto payoff : {OptionPayoff::Call, OptionPayoff::Put}) {
+    const VanillaOption option(105, payoff);
+    EXPECT_NEAR(
+        option.blackScholesGreek(100, kVol, 1.0, kRate, 0.0, Greeks::Theta),
+        jr_deriv.priceWithGreeks(option, 1.0).theta,
+        2e-4);
+  }
+
+  // Early exercise makes an ITM put behave more like the asset itself.
+  const auto european_put = rolling_deriv.priceWithGreeks(
+      VanillaOption(105, OptionPayoff::Put), 1.0);
+  const auto american_put = rolling_deriv.priceWithGreeks(
+      VanillaOption(105, OptionPayoff::Put, ExerciseStyle::American), 1.0);
+  EXPECT_LT(american_put.delta, european_put.delta);
+  EXPECT_GT(american_put.delta, -1.0);
+  EXPECT_GT(american_put.gamma, 0.0);
+}
+
+TEST(DerivativeTest, BlackScholesSmoothing) {
+  StochasticTreeModel<CRRPropagator> asset(BinomialTree(1.02, 1 / 100.),
+                                           CRRPropagator(100));
+  asset.forwardPropagate(Volatility(FlatVol(0.2)));
+  ZeroSpotCurve curve({1.0, 10.0}, {0.05, 0.05});
+
+  SingleAssetDerivative deriv(&asset.binomialTree(), &curve);
+  SingleAssetDerivative smoothed_deriv(&asset.binomialTree(),
+                                       &curve,
+                                       BackwardInductionStorage::kFullTree,
+                                       TerminalSmoothing::kBlackScholes);
+  SingleAssetDerivative rolling_smoothed_deriv(
+      &asset.binomialTree(),
+      &curve,
+      BackwardInductionStorage::kRollingTimeslices,
+      TerminalSmoothing::kBlackScholes);
+
+  // Off-node strikes are where the binomial error oscillates the most.
+  double max_error = 0.0;
+  double max_smoothed_error = 0.0;
+  std::vector<VanillaOption> options;
+  for (double strike = 80; strike <= 120; strike += 2.5) {
+    const VanillaOption put(strike, OptionPayoff::Put);
+    const double bsm = put.blackScholes(100, 0.2, 1.0, 0.05, 0.0);
+    max_error = std::max(max_error, std::abs(deriv.price(put, 1.0) - bsm));
+    max_smoothed_error = std::max(
+        max_smoothed_error, std::abs(smoothed_deriv.price(put, 1.0) - bsm));
+    options.push_back(put);
+    options.emplace_back(strike, OptionPayoff::Put, ExerciseStyle::American);
+  }
+  EXPECT_LT(max_smoothed_error, max_error / 2);
+
+  // Smoothing is applied consistently by every pricing method.
+  const auto prices = rolling_smoothed_deriv.priceBatch(options, 1.0);
+  for (size_t k = 0; k < options.size(); ++k) {
+    const double price = smoothed_deriv.price(options[k], 1.0);
+    EXPECT_DOUBLE_EQ(price, rolling_smoothed_deriv.price(options[k], 1.0));
+    EXPECT_NEAR(price, prices[k], 1e-12);
+  }
+}
+
+// The number of timesteps which the propagators need to price European
+// options within 1e-4 of Black-Scholes. Leisen-Reimer converges at O(1/N^2)
+// without oscillating, so that about a hundred steps suffice, whereas CRR and
+// Tian still oscillate by more than that with thousands.
+TEST(DerivativeTest, LeisenReimerConvergesToBlackScholes) {
+  ZeroSpotCurve curve(
+      {1.0, 10.0}, {0.05, 0.05}, CompoundingPeriod::kContinuous);
+  ZeroSpotCurve foreign_curve(
+      {1.0, 10.0}, {0.02, 0.02}, CompoundingPeriod::kContinuous);
+  const Volatility flat_vol(FlatVol(0.2));
+  const auto price_error = [&](const auto& propagator,
+                               const VanillaOption& option,
+                               int num_steps) {
+    const double dt = 1.0 / num_steps;
+    StochasticTreeModel asset(BinomialTree(1.0 + 2 * dt, dt), propagator);
+    asset.forwardPropagate(flat_vol);
+    SingleAssetDerivative deriv(&asset.binomialTree(),
+                                &curve,
+                                BackwardInductionStorage::kRollingTimeslices);
+    return std::abs(deriv.price(option, 1.0) -
+                    option.blackScholes(100, 0.2, 1.0, 0.05, 0.0));
+  };
+
+  for (const auto& option : {VanillaOption(105, OptionPayoff::Call),
+                             VanillaOption(95, OptionPayoff::Put)}) {
+    const LeisenReimerPropagator leisen_reimer(
+        curve, 100, option.strike(), 1.0);
+    EXPECT_GT(price_error(leisen_reimer, option, 25), 1e-4);
+    EXPECT_LT(price_error(leisen_reimer, option, 101), 1e-4);
+    EXPECT_NEAR(4.0,
+                price_error(leisen_reimer, option, 101) /
+                    price_error(leisen_reimer, option, 201),
+                0.3);
+
+    EXPECT_GT(price_error(CRRPropagator(100), option, 1601), 1e-4);
+    const double tian_error =
+        price_error(TianPropagator(curve, 100), option, 1601);
+    EXPECT_GT(tian_error, 1e-4);
+    EXPECT_LT(tian_error, 2e-3);
+  }
+
+  // Currency options, with the foreign curve in both the tree and the
+  // derivative.
+  const VanillaOption call(105, OptionPayoff::Call);
+  StochasticTreeModel asset(
+      BinomialTree(1.0 + 2 / 101., 1 / 101.),
+      LeisenReimerPropagator(curve, 100, 105, 1.0, &foreign_curve));
+  asset.forwardPropagate(flat_vol);
+  CurrencyDerivative deriv(&asset.binomialTree(), &curve, &foreign_curve);
+  EXPECT_NEAR(call.blackScholes(100, 0.2, 1.0, 0.05, 0.02),
+              deriv.price(call, 1.0),
+              1e-4);
+}
+
+TEST(DerivativeTest, ControlVariateAmericanPricing) {
+  ZeroSpotCurve curve(
+      {1.0, 10.0}, {0.05, 0.05}, CompoundingPeriod::kContinuous);
+  const Volatility flat_vol(FlatVol(0.2));
+  struct {
+    double strike;
+    // Converged to about 3e-5 with 20000 timesteps.
+    double reference_price;
+  } cases[] = {{90, 2.47227}, {100, 6.09039}, {110, 11.97283}};
+
+  auto create_asset = [&](int num_steps) {
+    const double dt = 1.0 / num_steps;
+    StochasticTreeModel asset(BinomialTree(1.0 + 2 * dt, dt),
+                              CRRPropagator(100));
+    asset.forwardPropagate(flat_vol);
+    return asset;
+  };
+  const auto asset = create_asset(201);
+  const auto finer_asset = create_asset(801);
+  SingleAssetDerivative deriv(&asset.binomialTree(),
+                              &curve,
+                              BackwardInductionStorage::kRollingTimeslices,
+                              TerminalSmoothing::kBlackScholes);
+  SingleAssetDerivative finer_deriv(
+      &finer_asset.binomialTree(),
+      &curve,
+      BackwardInductionStorage::kRollingTimeslices,
+      TerminalSmoothing::kBlackScholes);
+
+  for (const auto& [strike, reference_price] : cases) {
+    const VanillaOption put(strike, OptionPayoff::Put, ExerciseStyle::American);
+    const double error = std::abs(
+        deriv.priceWithControlVariate(put, 1.0, 0.2) - reference_price);
+    EXPECT_LT(error, 3e-4);
+
+    // A tree four times as fine is still less accurate without the control
+    // variate.
+    EXPECT_LT(error, std::abs(finer_deriv.price(put, 1.0) - reference_price));
+  }
+
+  // European options are priced exactly.
+  const VanillaOption call(105, OptionPayoff::Call);
+  EXPECT_DOUBLE_EQ(call.blackScholes(100, 0.2, 1.0, 0.05, 0.0),
+                   deriv.priceWithControlVariate(call, 1.0, 0.2));
+}
+
+TEST(DerivativeTest, BarrierOptionsConvergeOnAlignedGrids) {
+  ZeroSpotCurve curve(
+      {1.0, 10.0}, {0.05, 0.05}, CompoundingPeriod::kContinuous);
+  ZeroSpotCurve foreign_curve(
+      {1.0, 10.0}, {0.02, 0.02}, CompoundingPeriod::kContinuous);
+  const Volatility flat_vol(FlatVol(0.2));
+  auto create_asset = [&](int num_steps) {
+    const double dt = 1.0 / num_steps;
+    StochasticTreeModel asset(BinomialTree(1.0 + 2 * dt, dt),
+                              CRRPropagator(100));
+    asset.forwardPropagate(flat_vol);
+    return asset;
+  };
+  const auto naive_asset = create_asset(400);
+
+  for (const auto& barrier_option :
+       {BarrierOption(VanillaOption(100, OptionPayoff::Call),
+                      90,
+                      BarrierType::kDownAndOut),
+        BarrierOption(VanillaOption(100, OptionPayoff::Call),
+                      120,
+                      BarrierType::kUpAndOut),
+        BarrierOption(VanillaOption(100, OptionPayoff::Put),
+                      90,
+                      BarrierType::kDownAndIn),
+        BarrierOption(VanillaOption(95, OptionPayoff::Put),
+                      110,
+                      BarrierType::kUpAndOut)}) {
+    const double bsm = barrier_option.blackScholes(100, 0.2, 1.0, 0.05, 0.0);
+    SingleAssetDerivative naive_deriv(
+        &naive_asset.binomialTree(),
+        &curve,
+        BackwardInductionStorage::kRollingTimeslices);
+    EXPECT_GT(std::abs(naive_deriv.price(barrier_option, 1.0) - bsm), 2e-2);
+
+    // A few more timesteps, such that a layer of nodes lies on the barrier.
+    const auto aligned_asset = create_asset(
+        barrierAlignedTimesteps(100, barrier_option.barrier(), 0.2, 1.0, 400));
+    SingleAssetDerivative aligned_deriv(&aligned_asset.binomialTree(), &curve);
+    EXPECT_NEAR(bsm, aligned_deriv.price(barrier_option, 1.0), 5e-3);
+  }
+
+  // FX barriers.
+  const BarrierOption up_and_out_call(
+      VanillaOption(100, OptionPayoff::Call), 115, BarrierType::kUpAndOut);
+  const auto fx_asset =
+      create_asset(barrierAlignedTimesteps(100, 115, 0.2, 1.0, 400));
+  CurrencyDerivative fx_deriv(
+      &fx_asset.binomialTree(), &curve, &foreign_curve);
+  EXPECT_NEAR(up_and_out_call.blackScholes(100, 0.2, 1.0, 0.05, 0.02),
+              fx_deriv.price(up_and_out_call, 1.0),
+              5e-3);
+
+  // Early exercise is worth something for knock-outs, but knock-ins with
+  // early exercise are not supported.
+  const VanillaOption american_put(
+      100, OptionPayoff::Put, ExerciseStyle::American);
+  EXPECT_GT(fx_deriv.price(BarrierOption(american_put,
+                                         115,
+                                         BarrierType::kUpAndOut),
+                           1.0),
+            fx_deriv.price(BarrierOption(american_put.asEuropean(),
+                                         115,
+                                         BarrierType::kUpAndOut),
+                           1.0));
+  EXPECT_EQ(0.0,
+            fx_deriv.price(
+                BarrierOption(american_put, 115, BarrierType::kUpAndIn), 1.0));
+}
+
+TEST(DerivativeTest, BarrierOptionsSupportSmoothingAndTruncation) {
+  ZeroSpotCurve curve(
+      {1.0, 10.0}, {0.05, 0.05}, CompoundingPeriod::kContinuous);
+  const Volatility flat_vol(FlatVol(0.2));
+  const BarrierOption up_and_out_call(
+      VanillaOption(100, OptionPayoff::Call), 120, BarrierType::kUpAndOut);
+  const BarrierOption down_and_out_put(
+      VanillaOption(105, OptionPayoff::Put), 85, BarrierType::kDownAndOut);
+  const double dt = 1.0 / barrierAlignedTimesteps(100, 120, 0.2, 1.0, 400);
+  BinomialTree tree(1.0 + 2 * dt, dt);
+  StochasticTreeModel asset(tree, CRRPropagator(100));
+  asset.forwardPropagate(flat_vol);
+
+  // The last step is smoothed with the closed form of the knock-out option,
+  // rather than that of the vanilla option.
+  SingleAssetDerivative smoothed_deriv(&asset.binomialTree(),
+                                       &curve,
+                                       BackwardInductionStorage::kFullTree,
+                                       TerminalSmoothing::kBlackScholes);
+  EXPECT_NEAR(up_and_out_call.blackScholes(100, 0.2, 1.0, 0.05, 0.0),
+              smoothed_deriv.price(up_and_out_call, 1.0),
+              1e-3);
+
+  // The band is narrower than the distance to the barrier early on, so the
+  // boundary nodes must account for it.
+  tree.truncate(3);
+  StochasticTreeModel truncated_asset(tree, CRRPropagator(100));
+  truncated_asset.forwardPropagate(flat_vol);
+  for (auto smoothing :
+       {TerminalSmoothing::kNone, TerminalSmoothing::kBlackScholes}) {
+    SingleAssetDerivative full_deriv(
+        &asset.binomialTree(),
+        &curve,
+        BackwardInductionStorage::kRollingTimeslices,
+        smoothing);
+    SingleAssetDerivative truncated_deriv(
+        &truncated_asset.binomialTree(),
+        &curve,
+        BackwardInductionStorage::kRollingTimeslices,
+        smoothing);
+    for (const auto& barrier_option : {up_and_out_call, down_and_out_put}) {
+      EXPECT_NEAR(full_deriv.price(barrier_option, 1.0),
+                  truncated_deriv.price(barrier_option, 1.0),
+                  1e-3);
+    }
+  }
+}
+
+TEST(DerivativeTest, SpotChangesRescaleImplicitLattices) {
+  ZeroSpotCurve domestic_curve({1.0, 10.0}, {0.05, 0.05});
+  ZeroSpotCurve foreign_curve({1.0, 10.0}, {0.02, 0.02});
+  Volatility flat_vol(FlatVol(0.2));
+  auto create_asset = [&](double spot) {
+    StochasticTreeModel asset(BinomialTree(1.1, 1 / 200.),
+                              JarrowRuddPropagator(0.03, spot));
+    asset.forwardPropagate(flat_vol);
+    return asset;
+  };
+
+  auto asset = create_asset(100);
+  CurrencyDerivative deriv(&asset.binomialTree(),
+                           &domestic_curve,
+                           &foreign_curve,
+                           BackwardInductionStorage::kRollingTimeslices);
+  const VanillaOption american_put(
+      105, OptionPayoff::Put, ExerciseStyle::American);
+  const VanillaOption call(95, OptionPayoff::Call);
+
+  const std::vector<double> spots = {80, 95, 100, 104.5, 130};
+  const auto put_ladder = deriv.priceSpotLadder(american_put, 1.0, spots);
+  const auto call_ladder = deriv.priceSpotLadder(call, 1.0, spots);
+
+  // The same, through the const overload with a caller-owned workspace.
+  const CurrencyDerivative& const_deriv = deriv;
+  PricingWorkspace workspace;
+  EXPECT_EQ(put_ladder,
+            const_deriv.priceSpotLadder(american_put, 1.0, spots, workspace));
+  for (size_t m = 0; m < spots.size(); ++m) {
+    const auto rebuilt_asset = create_asset(spots[m]);
+    CurrencyDerivative rebuilt_deriv(
+        &rebuilt_asset.binomialTree(), &domestic_curve, &foreign_curve);
+    const double put_price = rebuilt_deriv.price(american_put, 1.0);
+    const double call_price = rebuilt_deriv.price(call, 1.0);
+    EXPECT_NEAR(put_price, put_ladder[m], 1e-12 * spots[m]);
+    EXPECT_NEAR(call_price, call_ladder[m], 1e-12 * spots[m]);
+
+    // Moving the spot of the existing tree has the same effect, without a
+    // forward propagation.
+    EXPECT_TRUE(asset.updateSpot(spots[m]));
+    EXPECT_NEAR(put_price, deriv.price(american_put, 1.0), 1e-12 * spots[m]);
+  }
+
+  // Local vol trees are not proportional to spot.
+  StochasticTreeModel lv_asset(BinomialTree(1.1, 1 / 50.),
+                               LocalVolatilityPropagator(domestic_curve, 100));
+  lv_asset.forwardPropagate(Volatility(MildSkewLocalVol()));
+  EXPECT_FALSE(lv_asset.updateSpot(90));
+  SingleAssetDerivative lv_deriv(&lv_asset.binomialTree(), &domestic_curve);
+  EXPECT_EQ(std::vector<double>(spots.size(), 0.0),
+            lv_deriv.priceSpotLadder(call, 1.0, spots));
+}
+
+TEST(DerivativeTest, ConcurrentPricingWithWorkspaces) {
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  StochasticTreeModel asset(BinomialTree(1.1, 1 / 200.),
+                            LocalVolatilityPropagator(curve, 100));
+  asset.forwardPropagate(Volatility(MildSkewLocalVol()));
+  const SingleAssetDerivative deriv(
+      &asset.binomialTree(), &curve, BackwardInductionStorage::kFullTree);
+
+  std::vector<VanillaOption> options;
+  for (int k = 0; k < 32; ++k) {
+    options.emplace_back(85 + k, OptionPayoff::Put, ExerciseStyle::American);
+  }
+  std::vector<double> expected;
+  PricingWorkspace workspace;
+  for (const auto& option : options) {
+    expected.push_back(deriv.price(option, 1.0, workspace));
+  }
+
+  // Every thread prices every option, with its own workspace.
+  constexpr int kNumThreads = 4;
+  std::vector<std::vector<double>> prices(kNumThreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&, t] {
+      PricingWorkspace thread_workspace;
+      for (int k = 0; k < std::ssize(options); ++k) {
+        const auto& option = options[(k + 7 * t) % options.size()];
+        prices[t].push_back(deriv.price(option, 1.0, thread_workspace));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int t = 0; t < kNumThreads; ++t) {
+    for (int k = 0; k < std::ssize(options); ++k) {
+      EXPECT_EQ(expected[(k + 7 * t) % options.size()], prices[t][k]);
+    }
+  }
+}
+
+TEST(DerivativeTest, SinglePrecisionTrees) {
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  auto create_asset = [&](StoragePrecision precision) {
+    BinomialTree tree(1.1, 1 / 200.);
+    tree.setStoragePrecision(precision);
+    StochasticTreeModel asset(tree, LocalVolatilityPropagator(curve, 100));
+    asset.forwardPropagate(Volatility(MildSkewLocalVol()));
+    return asset;
+  };
+  const auto asset = create_asset(StoragePrecision::kDouble);
+  const auto single_asset = create_asset(StoragePrecision::kSingle);
+  EXPECT_EQ(StoragePrecision::kSingle,
+            single_asset.binomialTree().storagePrecision());
+
+  SingleAssetDerivative deriv(&asset.binomialTree(), &curve);
+  SingleAssetDerivative single_deriv(&single_asset.binomialTree(), &curve);
+  for (double strike : {90.0, 100.0, 110.0}) {
+    const VanillaOption american_put(
+        strike, OptionPayoff::Put, ExerciseStyle::American);
+    const double price = deriv.price(american_put, 1.0);
+    const double single_price = single_deriv.price(american_put, 1.0);
+    EXPECT_NEAR(price, single_price, 1e-5 * price);
+
+    // The derivative tree is stored in single precision too, but the price
+    // is not rounded.
+    const auto& single_deriv_tree = single_deriv.binomialTree();
+    EXPECT_EQ(StoragePrecision::kSingle, single_deriv_tree.storagePrecision());
+    EXPECT_EQ(static_cast<float>(single_price),
+              single_deriv_tree.nodeValue(0, 0));
+  }
+}
+
+TEST(DerivativeTest, ParallelBackwardInductionMatchesSerial) {
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  BinomialTree lv_tree(1.1, 1 / 100.);
+  lv_tree.truncate(5);
+  StochasticTreeModel lv_asset(lv_tree, LocalVolatilityPropagator(curve, 100));
+  lv_asset.forwardPropagate(Volatility(MildSkewLocalVol()));
+  BinomialTree truncated_tree(1.1, 1 / 400.);
+  truncated_tree.truncate(6);
+  StochasticTreeModel truncated_asset(truncated_tree, CRRPropagator(100));
+  truncated_asset.forwardPropagate(Volatility(FlatVol(0.2)));
+
+  // Small blocks, so that even this tree is split across the threads.
+  ThreadPool pool(4);
+  const VanillaOption american_put(
+      105, OptionPayoff::Put, ExerciseStyle::American);
+  for (const BinomialTree* tree :
+       {&lv_asset.binomialTree(), &truncated_asset.binomialTree()}) {
+    for (auto storage : {BackwardInductionStorage::kFullTree,
+                         BackwardInductionStorage::kRollingTimeslices}) {
+      SingleAssetDerivative serial_deriv(
+          tree, &curve, storage, TerminalSmoothing::kBlackScholes);
+      SingleAssetDerivative parallel_deriv(
+          tree, &curve, storage, TerminalSmoothing::kBlackScholes);
+      parallel_deriv.setThreadPool(&pool, 16);
+      EXPECT_DOUBLE_EQ(serial_deriv.price(american_put, 1.0),
+                       parallel_deriv.price(american_put, 1.0));
+    }
+
+    // On a copy of the tree, so that the Arrow-Debreu tree is not shared.
+    const BinomialTree tree_copy = *tree;
+    SingleAssetDerivative serial_deriv(tree, &curve);
+    SingleAssetDerivative parallel_deriv(&tree_copy, &curve);
+    parallel_deriv.setThreadPool(&pool, 16);
+    const auto& serial_ad_tree = *serial_deriv.arrowDebreuTree();
+    const auto& parallel_ad_tree = *parallel_deriv.arrowDebreuTree();
+    for (int ti = 0; ti < serial_ad_tree.numTimesteps(); ++ti) {
+      EXPECT_DOUBLE_EQ(serial_ad_tree.sumAtTimestep(ti),
+                       parallel_ad_tree.sumAtTimestep(ti));
+    }
+  }
+}
+
+TEST(DerivativeTest, ParallelInductionOnLargeTreeMatchesSerial) {
+  // Wide enough timeslices that every job is split into many blocks, so that
+  // the workers (and not just the calling thread) pick some of them up.
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  BinomialTree tree(1.1, 1 / 3000.);
+  StochasticTreeModel asset(tree, CRRPropagator(100));
+  asset.forwardPropagate(Volatility(FlatVol(0.2)));
+  const BinomialTree& asset_tree = asset.binomialTree();
+  const BinomialTree tree_copy = asset_tree;
+
+  ThreadPool pool(4);
+  SingleAssetDerivative serial_deriv(&asset_tree, &curve);
+  SingleAssetDerivative parallel_deriv(&tree_copy, &curve);
+  parallel_deriv.setThreadPool(&pool, 64);
+
+  const auto serial_ad_tree = serial_deriv.arrowDebreuTree();
+  const auto parallel_ad_tree = parallel_deriv.arrowDebreuTree();
+  for (int ti = 0; ti < serial_ad_tree->numTimesteps(); ti += 100) {
+    EXPECT_DOUBLE_EQ(serial_ad_tree->sumAtTimestep(ti),
+                     parallel_ad_tree->sumAtTimestep(ti));
+  }
+
+  // The Arrow-Debreu tree stays cached while nothing changes.
+  EXPECT_EQ(parallel_ad_tree, parallel_deriv.arrowDebreuTree());
+
+  const VanillaOption american_put(
+      100, OptionPayoff::Put, ExerciseStyle::American);
+  EXPECT_DOUBLE_EQ(serial_deriv.price(american_put, 1.0),
+                   parallel_deriv.price(american_put, 1.0));
+}
+
+TEST(DerivativeTest, ArrowDebreuTreeIsCachedUntilInputsChange) {
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  ZeroSpotCurve foreign_curve({1.0, 10.0}, {0.02, 0.02});
+  StochasticTreeModel asset(BinomialTree(1.1, 1 / 100.),
+                            LocalVolatilityPropagator(curve, 100));
+  asset.forwardPropagate(Volatility(MildSkewLocalVol()));
+  const BinomialTree& tree = asset.binomialTree();
+  const auto cache = ArrowDebreuCache::forInputs(&tree, &curve);
+  const auto dfSum = [&](const std::shared_ptr<const BinomialTree>& ad_tree) {
+    return ad_tree->sumAtTimestep(100);
+  };
+
+  // Computed once, and shared by every derivative on the tree and curve.
+  SingleAssetDerivative deriv(&tree, &curve);
+  SingleAssetDerivative other_deriv(&tree, &curve);
+  const auto ad_tree = deriv.arrowDebreuTree();
+  EXPECT_EQ(ad_tree, other_deriv.arrowDebreuTree());
+  EXPECT_EQ(ad_tree, deriv.arrowDebreuTree());
+  EXPECT_EQ(1, cache->numUpdates());
+  EXPECT_NEAR(curve.df(tree.totalTimeAtIndex(100)), dfSum(ad_tree), 1e-10);
+
+  // Pricing does not change the tree or the curve.
+  deriv.price(VanillaOption(100, OptionPayoff::Put), 1.0);
+  other_deriv.arrowDebreuTree();
+  EXPECT_EQ(1, cache->numUpdates());
+
+  // A change to the curve is picked up, and leaves the earlier snapshot
+  // untouched.
+  const double sum_before = dfSum(ad_tree);
+  curve.updateRateAtMaturityIndex(0, 0.03);
+  EXPECT_NEAR(curve.df(tree.totalTimeAtIndex(100)),
+              dfSum(other_deriv.arrowDebreuTree()),
+              1e-10);
+  EXPECT_EQ(2, cache->numUpdates());
+  EXPECT_EQ(sum_before, dfSum(ad_tree));
+
+  // So is a change to the asset tree.
+  const double sum_before_propagation = dfSum(deriv.arrowDebreuTree());
+  asset.forwardPropagate(Volatility(FlatVol(0.3)));
+  EXPECT_NE(sum_before_propagation, dfSum(deriv.arrowDebreuTree()));
+  EXPECT_EQ(3, cache->numUpdates());
+
+  // Derivatives on the same tree under other curves have caches of their
+  // own, so alternating between them recomputes nothing.
+  ZeroSpotCurve other_curve({1.0, 10.0}, {0.01, 0.01});
+  SingleAssetDerivative other_curve_deriv(&tree, &other_curve);
+  CurrencyDerivative fx_deriv(&tree, &curve, &foreign_curve);
+  const auto other_curve_cache =
+      ArrowDebreuCache::forInputs(&tree, &other_curve);
+  const auto fx_cache =
+      ArrowDebreuCache::forInputs(&tree, &curve, &foreign_curve);
+  for (int k = 0; k < 3; ++k) {
+    EXPECT_NEAR(curve.df(tree.totalTimeAtIndex(100)),
+                dfSum(deriv.arrowDebreuTree()),
+                1e-10);
+    EXPECT_NEAR(other_curve.df(tree.totalTimeAtIndex(100)),
+                dfSum(other_curve_deriv.arrowDebreuTree()),
+                1e-10);
+    fx_deriv.arrowDebreuTree();
+  }
+  EXPECT_EQ(3, cache->numUpdates());
+  EXPECT_EQ(1, other_curve_cache->numUpdates());
+  EXPECT_EQ(1, fx_cache->numUpdates());
+
+  // Currency derivatives also depend on the foreign curve.
+  foreign_curve.updateRateAtMaturityIndex(0, 0.01);
+  fx_deriv.arrowDebreuTree();
+  EXPECT_EQ(2, fx_cache->numUpdates());
+}
+
+TEST(DerivativeTest, EuropeanBatchMatchesBackwardInduction) {
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  StochasticTreeModel asset(BinomialTree(1.1, 1 / 200.),
+                            LocalVolatilityPropagator(curve, 100));
+  asset.forwardPropagate(Volatility(MildSkewLocalVol()));
+  SingleAssetDerivative deriv(&asset.binomialTree(), &curve);
+
+  std::vector<EuropeanPayoff> payoffs;
+  // Off the spine of the tree, which is at the spot.
+  for (double strike : {80.5, 95.5, 100.5, 105.5, 120.5}) {
+    payoffs.push_back(VanillaOption(strike, OptionPayoff::Call));
+    payoffs.push_back(VanillaOption(strike, OptionPayoff::Put));
+    payoffs.push_back(DigitalOption(strike, OptionPayoff::Call));
+    payoffs.push_back(DigitalOption(strike, OptionPayoff::Put));
+    payoffs.push_back(VerticalSpread(strike, strike + 10, OptionPayoff::Call));
+  }
+  const std::vector<double> prices = deriv.priceEuropeanBatch(payoffs, 1.0);
+  ASSERT_EQ(payoffs.size(), prices.size());
+
+  const double df = curve.df(1.0);
+  for (size_t k = 0; k < payoffs.size(); k += 5) {
+    const auto& call = std::get<VanillaOption>(payoffs[k]);
+    const auto& put = std::get<VanillaOption>(payoffs[k + 1]);
+    EXPECT_NEAR(deriv.price(call, 1.0), prices[k], 1e-10);
+    EXPECT_NEAR(deriv.price(put, 1.0), prices[k + 1], 1e-10);
+
+    // Unless the strike is on a node, a digital call and put add up to a
+    // zero-coupon bond.
+    EXPECT_NEAR(df, prices[k + 2] + prices[k + 3], 1e-10);
+
+    // A call spread is a call less another call.
+    const double upper_call =
+        deriv.price(call.withStrike(call.strike() + 10), 1.0);
+    EXPECT_NEAR(prices[k] - upper_call, prices[k + 4], 1e-10);
+  }
+
+  // Out of the tree.
+  EXPECT_EQ(std::vector<double>(payoffs.size(), 0.0),
+            deriv.priceEuropeanBatch(payoffs, 5.0));
+}
+
+TEST(DerivativeTest, BatchPricingMatchesIndividualPrices) {
+  StochasticTreeModel<CRRPropagator> asset(BinomialTree(1.1, 1 / 100.),
+                                           CRRPropagator(100));
+  asset.forwardPropagate(Volatility(FlatVol(0.2)));
+  ZeroSpotCurve domestic_curve({1.0, 10.0}, {0.05, 0.05});
+  ZeroSpotCurve foreign_curve({1.0, 10.0}, {0.02, 0.02});
+  CurrencyDerivative deriv(&asset.binomialTree(),
+                           &domestic_curve,
+                           &foreign_curve,
+                           BackwardInductionStorage::kRollingTimeslices);
+
+  std::vector<VanillaOption> chain;
+  for (double strike = 80; strike <= 120; strike += 5) {
+    chain.emplace_back(strike, OptionPayoff::Call);
+    chain.emplace_back(strike, OptionPayoff::Put, ExerciseStyle::American);
+  }
+
+  const auto prices = deriv.priceBatch(chain, 0.75);
+  ASSERT_EQ(chain.size(), prices.size());
+  for (size_t k = 0; k < chain.size(); ++k) {
+    EXPECT_NEAR(deriv.price(chain[k], 0.75), prices[k], 1e-12);
+  }
+}
+
+TEST(DerivativeTest, SurfacePricingMatchesIndividualPrices) {
+  StochasticTreeModel<CRRPropagator> asset(BinomialTree(2.1, 1 / 100.),
+                                           CRRPropagator(100));
+  asset.forwardPropagate(Volatility(FlatVol(0.2)));
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  SingleAssetDerivative deriv(&asset.binomialTree(), &curve);
+
+  const std::vector<VanillaOption> options = {
+      VanillaOption(90, OptionPayoff::Put, ExerciseStyle::American),
+      VanillaOption(100, OptionPayoff::Call),
+      VanillaOption(110, OptionPayoff::Call, ExerciseStyle::American)};
+  // Deliberately unsorted, with a repeated expiry and one beyond the tree.
+  const std::vector<double> expiries = {0.5, 2.0, 0.25, 0.5, 5.0};
+
+  const auto prices = deriv.priceSurface(options, expiries);
+  ASSERT_EQ(expiries.size(), prices.size());
+  for (size_t e = 0; e < expiries.size() - 1; ++e) {
+    ASSERT_EQ(options.size(), prices[e].size());
+    for (size_t k = 0; k < options.size(); ++k) {
+      EXPECT_NEAR(deriv.price(options[k], expiries[e]), prices[e][k], 1e-12);
+    }
+  }
+  EXPECT_EQ(std::vector<double>(options.size(), 0.0), prices.back());
+}
+
+// Straightforward node-by-node backward induction, used as a reference for the
+// vectorised timeslice kernel.
+double referenceBackwardInduction(const BinomialTree& asset_tree,
+                                  const RatesCurve& curve,
+                                  double strike,
+                                  OptionPayoff payoff,
+                                  ExerciseStyle style,
+                                  double expiry_years) {
+  const auto& timegrid = asset_tree.getTimegrid();
+  const int ti_final = timegrid.getTimeIndexForExpiry(expiry_years).value();
+  auto intrinsic = [&](double state) {
+    return std::max(
+        0.0, payoff == OptionPayoff::Call ? state - strike : strike - state);
+  };
+
+  std::vector<double> values(ti_final + 1);
+  for (int i = 0; i <= ti_final; ++i) {
+    values[i] = intrinsic(asset_tree.nodeValue(ti_final, i));
+  }
+  for (int ti = ti_final - 1; ti >= 0; --ti) {
+    const double fwd_df =
+        curve.forwardDF(timegrid.time(ti), timegrid.time(ti + 1));
+    for (int i = 0; i <= ti; ++i) {
+      const double p = asset_tree.getUpProbAt(curve, ti, i);
+      values[i] = fwd_df * (values[i + 1] * p + values[i] * (1 - p));
+      if (style == ExerciseStyle::American) {
+        values[i] = std::max(values[i], intrinsic(asset_tree.nodeValue(ti, i)));
+      }
+    }
+  }
+  return values[0];
+}
+
+struct SkewedLocalVol {
+  static constexpr VolSurfaceFnType type =
+      VolSurfaceFnType::kTimeInvariantSkewSmile;
+  double operator()(double s) const {
+    return std::max(0.2 - 0.5 * (s - 100) / 100, 0.05);
+  }
+};
+
+TEST(DerivativeTest, TimesliceKernelMatchesPerNodeRecursion) {
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+
+  StochasticTreeModel crr_asset(BinomialTree(1.1, 1 / 200.),
+                                CRRPropagator(100));
+  crr_asset.forwardPropagate(Volatility(FlatVol(0.2)));
+  StochasticTreeModel lv_asset(BinomialTree(1.1, 1 / 50.),
+                               LocalVolatilityPropagator(curve, 100));
+  lv_asset.forwardPropagate(Volatility(SkewedLocalVol()));
+
+  for (const BinomialTree* asset_tree :
+       {&crr_asset.binomialTree(), &lv_asset.binomialTree()}) {
+    SingleAssetDerivative full_tree_deriv(asset_tree, &curve);
+    SingleAssetDerivative rolling_deriv(
+        asset_tree, &curve, BackwardInductionStorage::kRollingTimeslices);
+    for (auto payoff : {OptionPayoff::Call, OptionPayoff::Put}) {
+      for (auto style : {ExerciseStyle::European, ExerciseStyle::American}) {
+        const double expected = referenceBackwardInduction(
+            *asset_tree, curve, 102, payoff, style, 1.0);
+        const VanillaOption option(102, payoff, style);
+        EXPECT_NEAR(expected, full_tree_deriv.price(option, 1.0), 1e-12);
+        EXPECT_NEAR(expected, rolling_deriv.price(option, 1.0), 1e-12);
+      }
+    }
+  }
+}
+
+// Expects every pricing method to give the same results on a truncated tree as
+// on the full tree, for options whose value is negligible far from the spine.
+void expectTruncatedPricesMatch(const BinomialTree& asset_tree,
+                                const BinomialTree& truncated_asset_tree,
+                                const RatesCurve& curve,
+                                const std::vector<double>& expiries,
+                                double tolerance) {
+  const std::vector<VanillaOption> options = {
+      VanillaOption(100, OptionPayoff::Call),
+      VanillaOption(130, OptionPayoff::Call, ExerciseStyle::American),
+      VanillaOption(80, OptionPayoff::Put, ExerciseStyle::American)};
+
+  SingleAssetDerivative deriv(
+      &asset_tree, &curve, BackwardInductionStorage::kRollingTimeslices);
+  SingleAssetDerivative truncated_deriv(&truncated_asset_tree, &curve);
+  SingleAssetDerivative smoothed_deriv(
+      &asset_tree,
+      &curve,
+      BackwardInductionStorage::kRollingTimeslices,
+      TerminalSmoothing::kBlackScholes);
+  SingleAssetDerivative truncated_smoothed_deriv(
+      &truncated_asset_tree,
+      &curve,
+      BackwardInductionStorage::kRollingTimeslices,
+      TerminalSmoothing::kBlackScholes);
+
+  const auto surface = truncated_smoothed_deriv.priceSurface(options, expiries);
+  for (size_t e = 0; e < expiries.size(); ++e) {
+    for (size_t k = 0; k < options.size(); ++k) {
+      EXPECT_NEAR(deriv.price(options[k], expiries[e]),
+                  truncated_deriv.price(options[k], expiries[e]),
+                  tolerance);
+      const double smoothed_price =
+          smoothed_deriv.price(options[k], expiries[e]);
+      EXPECT_NEAR(smoothed_price,
+                  truncated_smoothed_deriv.price(options[k], expiries[e]),
+                  tolerance);
+      EXPECT_NEAR(smoothed_price, surface[e][k], tolerance);
+    }
+  }
+
+  // State prices still sum to the discount factor.
+  const auto& ad_tree = *truncated_deriv.arrowDebreuTree();
+  const int ti =
+      truncated_asset_tree.getTimegrid().getTimeIndexForExpiry(1.0).value();
+  EXPECT_NEAR(curve.df(truncated_asset_tree.totalTimeAtIndex(ti)),
+              ad_tree.sumAtTimestep(ti),
+              tolerance);
+}
+
+TEST(DerivativeTest, TruncatedTreesMatchFullTrees) {
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+
+  // A 5-year daily tree, stored as an implicit lattice.
+  Volatility flat_vol(FlatVol(0.2));
+  BinomialTree crr_tree(5.01, 1 / 365.);
+  StochasticTreeModel crr_asset(crr_tree, CRRPropagator(100));
+  crr_asset.forwardPropagate(flat_vol);
+  crr_tree.truncate(8);
+  StochasticTreeModel truncated_crr_asset(crr_tree, CRRPropagator(100));
+  truncated_crr_asset.forwardPropagate(flat_vol);
+  expectTruncatedPricesMatch(crr_asset.binomialTree(),
+                             truncated_crr_asset.binomialTree(),
+                             curve,
+                             {1.0, 5.0},
+                             1e-10);
+
+  // A local vol tree, which is stored explicitly. With fewer timesteps, the
+  // band needs to be narrower to save anything.
+  Volatility local_vol(MildSkewLocalVol{});
+  BinomialTree lv_tree(1.01, 1 / 100.);
+  StochasticTreeModel lv_asset(lv_tree, LocalVolatilityPropagator(curve, 100));
+  lv_asset.forwardPropagate(local_vol);
+  lv_tree.truncate(5);
+  StochasticTreeModel truncated_lv_asset(lv_tree,
+                                         LocalVolatilityPropagator(curve, 100));
+  truncated_lv_asset.forwardPropagate(local_vol);
+  expectTruncatedPricesMatch(lv_asset.binomialTree(),
+                             truncated_lv_asset.binomialTree(),
+                             curve,
+                             {0.5, 1.0},
+                             1e-5);
+
+  // Only the nodes within the band are forward-propagated.
+  const auto& full = lv_asset.binomialTree();
+  const auto& truncated = truncated_lv_asset.binomialTree();
+  const int t_last = full.numTimesteps() - 1;
+  const NodeRange stored = truncated.materializedNodes(t_last);
+  EXPECT_LT(stored.size(), 0.6 * t_last);
+  EXPECT_EQ(0.0, truncated.nodeValue(t_last, 0));
+  for (int i = stored.first; i <= stored.last; ++i) {
+    EXPECT_DOUBLE_EQ(full.nodeValue(t_last, i), truncated.nodeValue(t_last, i));
+  }
 }
 
 }  // namespace
@@ -0,0 +1,67 @@
+#ifndef SMILEEXPLORER_DERIVATIVES_EUROPEAN_PAYOFFS_H_
+#define SMILEEXPLORER_DERIVATIVES_EUROPEAN_PAYOFFS_H_
+
+#include <Eigen/Dense>
+#include <variant>
+
+#include "derivatives/vanilla_option.h"
+
+namespace smileexplorer {
+
+// Pays `cash` if the asset ends up above (for a call) or below (for a put)
+// the strike, and nothing otherwise.
+struct DigitalOption {
+  DigitalOption(double strike, OptionPayoff payoff, double cash = 1.0)
+      : strike_(strike), payoff_(payoff), cash_(cash) {}
+
+  // Row-wise interface, as for VanillaOption.
+  template <typename StatesT>
+  auto payoff(const Eigen::ArrayBase<StatesT>& states) const {
+    const double sign = payoff_ == OptionPayoff::Call ? 1.0 : -1.0;
+    return cash_ * (sign * (states - strike_) > 0.0).template cast<double>();
+  }
+  bool hasEarlyExercise() const { return false; }
+
+ private:
+  double strike_;
+  OptionPayoff payoff_;
+  double cash_;
+};
+
+// A long call (or put) at one strike and a short call (or put) at the other,
+// such that the payoff is non-negative: a call spread is long the lower
+// strike, and a put spread is long the upper strike. The payoff is capped at
+// upper_strike - lower_strike.
+struct VerticalSpread {
+  VerticalSpread(double lower_strike, double upper_strike, OptionPayoff payoff)
+      : lower_strike_(lower_strike),
+        upper_strike_(upper_strike),
+        payoff_(payoff) {}
+
+  // Row-wise interface, as for VanillaOption.
+  template <typename StatesT>
+  auto payoff(const Eigen::ArrayBase<StatesT>& states) const {
+    const double sign = payoff_ == OptionPayoff::Call ? 1.0 : -1.0;
+    const double long_strike =
+        payoff_ == OptionPayoff::Call ? lower_strike_ : upper_strike_;
+    return (sign * (states - long_strike))
+        .max(0.0)
+        .min(upper_strike_ - lower_strike_);
+  }
+  bool hasEarlyExercise() const { return false; }
+
+ private:
+  double lower_strike_;
+  double upper_strike_;
+  OptionPayoff payoff_;
+};
+
+// Any payoff at expiry which SingleAssetDerivative::priceEuropeanBatch can
+// price, so that one batch may hold a mix of them (e.g. for static
+// replication).
+using EuropeanPayoff =
+    std::variant<VanillaOption, DigitalOption, VerticalSpread>;
+
+}  // namespace smileexplorer
+
+#endif  // SMILEEXPLORER_DERIVATIVES_EUROPEAN_PAYOFFS_H_
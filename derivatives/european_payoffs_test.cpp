@@ -0,0 +1,29 @@
+#include "european_payoffs.h"
+
+#include <gtest/gtest.h>
+
+namespace smileexplorer {
+namespace {
+
+TEST(EuropeanPayoffsTest, Digitals) {
+  const Eigen::ArrayXd states{{90, 100, 110}};
+  EXPECT_TRUE((DigitalOption(100, OptionPayoff::Call).payoff(states) ==
+               Eigen::ArrayXd{{0, 0, 1}})
+                  .all());
+  EXPECT_TRUE((DigitalOption(100, OptionPayoff::Put, 5).payoff(states) ==
+               Eigen::ArrayXd{{5, 0, 0}})
+                  .all());
+}
+
+TEST(EuropeanPayoffsTest, VerticalSpreads) {
+  const Eigen::ArrayXd states{{80, 95, 100, 105, 120}};
+  EXPECT_TRUE((VerticalSpread(90, 110, OptionPayoff::Call).payoff(states) ==
+               Eigen::ArrayXd{{0, 5, 10, 15, 20}})
+                  .all());
+  EXPECT_TRUE((VerticalSpread(90, 110, OptionPayoff::Put).payoff(states) ==
+               Eigen::ArrayXd{{20, 15, 10, 5, 0}})
+                  .all());
+}
+
+}  // namespace
+}  // namespace smileexplorer
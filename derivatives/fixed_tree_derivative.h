@@ -0,0 +1,101 @@
+#ifndef SMILEEXPLORER_DERIVATIVES_FIXED_TREE_DERIVATIVE_H_
+#define SMILEEXPLORER_DERIVATIVES_FIXED_TREE_DERIVATIVE_H_
+
+#include <Eigen/Dense>
+#include <array>
+#include <utility>
+
+#include "derivatives/vanilla_option.h"
+#include "rates/rates_curve.h"
+#include "trees/fixed_binomial_tree.h"
+
+namespace smileexplorer {
+
+// Prices options which expire at the end of a FixedBinomialTree, i.e. after
+// exactly N timesteps. Every curve lookup and up-probability is computed once,
+// on construction, so that pricing many options on the same tree (e.g. a
+// chain of intraday options) is a pure backward sweep over fixed-size
+// arrays. The sweep is unrolled at compile time, one timeslice at a time, so
+// that every timeslice is a fixed-size Eigen expression.
+//
+// Options are evaluated with the same row interface as SingleAssetDerivative
+// uses (payoff and hasEarlyExercise), e.g. with VanillaOption, which is
+// priced on its StaticVanillaOption.
+template <int N>
+class FixedTreeDerivative {
+ public:
+  // Pass a foreign curve to price currency options. The tree and curves are
+  // only read on construction, so they need not outlive this derivative.
+  FixedTreeDerivative(const FixedBinomialTree<N>& asset_tree,
+                      const RatesCurve& curve,
+                      const RatesCurve* foreign_curve = nullptr)
+      : asset_tree_(asset_tree) {
+    for (int t = 0; t < N; ++t) {
+      const double t_start = asset_tree.time(t);
+      const double t_end = asset_tree.time(t + 1);
+      fwd_dfs_[t] = curve.forwardDF(t_start, t_end);
+
+      double growth = curve.inverseForwardDF(t_start, t_end);
+      if (foreign_curve != nullptr) {
+        growth /= foreign_curve->inverseForwardDF(t_start, t_end);
+      }
+
+      // As in BinomialTransitionTable::upProb.
+      for (int i = 0; i <= t; ++i) {
+        const double curr = asset_tree.nodeValue(t, i);
+        const double up_ratio = asset_tree.nodeValue(t + 1, i + 1) / curr;
+        const double down_ratio = asset_tree.nodeValue(t + 1, i) / curr;
+        up_probs_[FixedBinomialTree<N>::timesliceOffset(t) + i] =
+            (growth - down_ratio) / (up_ratio - down_ratio);
+      }
+    }
+  }
+
+  double price(const VanillaOption& vanilla_option) const {
+    return vanilla_option.dispatch(
+        [this](const auto& option) { return price(option); });
+  }
+
+  template <typename OptionEvaluatorT>
+  double price(const OptionEvaluatorT& option_evaluator) const {
+    // Timeslices alternate between the two buffers, so that no timeslice is
+    // overwritten while it is being read.
+    std::array<std::array<double, N + 1>, 2> values;
+    Eigen::Map<Eigen::Array<double, N + 1, 1>>(values[N % 2].data()) =
+        option_evaluator.payoff(asset_tree_.template timeslice<N>());
+    [&]<int... Ts>(std::integer_sequence<int, Ts...>) {
+      (stepBack<N - 1 - Ts>(option_evaluator, values), ...);
+    }(std::make_integer_sequence<int, N>());
+    return values[0][0];
+  }
+
+ private:
+  FixedBinomialTree<N> asset_tree_;
+  std::array<double, N> fwd_dfs_;
+
+  // Up-probabilities out of every node before the final timeslice, in the
+  // same packed layout as the tree.
+  std::array<double, FixedBinomialTree<N>::kNumNodes - (N + 1)> up_probs_;
+
+  // Rolls the values at time index T + 1 back to T.
+  template <int T, typename OptionEvaluatorT>
+  void stepBack(const OptionEvaluatorT& option_evaluator,
+                std::array<std::array<double, N + 1>, 2>& values) const {
+    using Timeslice = Eigen::Array<double, T + 1, 1>;
+    using NextTimeslice = Eigen::Array<double, T + 2, 1>;
+    const Eigen::Map<const NextTimeslice> next(values[(T + 1) % 2].data());
+    const Eigen::Map<const Timeslice> p(
+        up_probs_.data() + FixedBinomialTree<N>::timesliceOffset(T));
+    Eigen::Map<Timeslice> curr(values[T % 2].data());
+    curr = fwd_dfs_[T] * (next.template tail<T + 1>() * p +
+                          next.template head<T + 1>() * (1 - p));
+    if (option_evaluator.hasEarlyExercise()) {
+      curr = curr.max(
+          option_evaluator.payoff(asset_tree_.template timeslice<T>()));
+    }
+  }
+};
+
+}  // namespace smileexplorer
+
+#endif  // SMILEEXPLORER_DERIVATIVES_FIXED_TREE_DERIVATIVE_H_
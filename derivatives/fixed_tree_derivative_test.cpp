@@ -0,0 +1,60 @@
+#include "derivatives/fixed_tree_derivative.h"
+
+#include <gtest/gtest.h>
+
+#include "derivatives/derivative.h"
+#include "derivatives/vanilla_option.h"
+#include "rates/zero_curve.h"
+#include "trees/propagators.h"
+#include "trees/stochastic_tree_model.h"
+#include "volatility/volatility.h"
+
+namespace smileexplorer {
+namespace {
+
+template <int N>
+void expectMatchesSingleAssetDerivative(const RatesCurve* foreign_curve) {
+  constexpr double kExpiry = 3 / 365.;
+  constexpr double kTimestep = kExpiry / N;
+  ZeroSpotCurve curve({1.0, 10.0}, {0.05, 0.05});
+  Volatility flat_vol(FlatVol(0.25));
+  const CRRPropagator propagator(100);
+
+  FixedBinomialTree<N> tree(kExpiry);
+  tree.forwardPropagate(propagator, flat_vol);
+  const FixedTreeDerivative<N> fixed_deriv(tree, curve, foreign_curve);
+
+  StochasticTreeModel asset(BinomialTree(kExpiry + 2 * kTimestep, kTimestep),
+                            propagator);
+  asset.forwardPropagate(flat_vol);
+  SingleAssetDerivative deriv(&asset.binomialTree(),
+                              &curve,
+                              BackwardInductionStorage::kRollingTimeslices);
+  CurrencyDerivative fx_deriv(&asset.binomialTree(),
+                              &curve,
+                              foreign_curve,
+                              BackwardInductionStorage::kRollingTimeslices);
+
+  for (double strike : {97.0, 100.0, 102.5}) {
+    for (auto payoff : {OptionPayoff::Call, OptionPayoff::Put}) {
+      for (auto style : {ExerciseStyle::European, ExerciseStyle::American}) {
+        const VanillaOption option(strike, payoff, style);
+        const double expected = foreign_curve != nullptr
+                                    ? fx_deriv.price(option, kExpiry)
+                                    : deriv.price(option, kExpiry);
+        EXPECT_NEAR(expected, fixed_deriv.price(option), 1e-12);
+      }
+    }
+  }
+}
+
+TEST(FixedTreeDerivativeTest, MatchesSingleAssetDerivative) {
+  expectMatchesSingleAssetDerivative<16>(nullptr);
+  expectMatchesSingleAssetDerivative<64>(nullptr);
+
+  ZeroSpotCurve foreign_curve({1.0, 10.0}, {0.08, 0.08});
+  expectMatchesSingleAssetDerivative<32>(&foreign_curve);
+}
+
+}  // namespace
+}  // namespace smileexplorer
@@ -0,0 +1,196 @@
+#ifndef SMILEEXPLORER_DERIVATIVES_IMPLIED_VOLATILITY_H_
+#define SMILEEXPLORER_DERIVATIVES_IMPLIED_VOLATILITY_H_
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "derivatives/derivative.h"
+#include "derivatives/richardson_extrapolation.h"
+#include "derivatives/thread_pool.h"
+#include "derivatives/vanilla_option.h"
+#include "rates/rates_curve.h"
+#include "trees/binomial_tree.h"
+#include "trees/stochastic_tree_model.h"
+#include "volatility/volatility.h"
+
+namespace smileexplorer {
+
+// A market price for an option.
+struct OptionQuote {
+  VanillaOption option;
+  double expiry_years;
+  double price;
+};
+
+struct ImpliedVolResult {
+  double vol = std::numeric_limits<double>::quiet_NaN();
+  int num_iterations = 0;
+
+  // False if the quote could not be matched within the tolerance, e.g.
+  // because it is below the intrinsic value. `vol` is then the closest vol
+  // found.
+  bool converged = false;
+};
+
+struct ImpliedVolSolverParams {
+  // Implied vols are searched for within [min_vol, max_vol].
+  double min_vol = 1e-4;
+  double max_vol = 5.0;
+
+  // Absolute tolerance on the price.
+  double price_tolerance = 1e-8;
+  int max_iterations = 50;
+
+  // The vol bump for the tree vega.
+  double vega_bump = 1e-4;
+};
+
+namespace internal {
+
+// Newton's method on a price which increases with the vol, safeguarded by
+// bisection: `vol` always stays within a bracket around the implied vol, and
+// bisects it whenever a Newton step would leave it. `price_and_slope(vol)`
+// returns the price at `vol` and its derivative with respect to the vol.
+template <typename PriceAndSlopeFnT>
+ImpliedVolResult solveForVol(PriceAndSlopeFnT&& price_and_slope,
+                             double target_price,
+                             double initial_vol,
+                             const ImpliedVolSolverParams& params) {
+  double lower = params.min_vol;
+  double upper = params.max_vol;
+  double vol = std::clamp(initial_vol, lower, upper);
+  ImpliedVolResult result;
+  double best_error = std::numeric_limits<double>::infinity();
+  for (result.num_iterations = 1;
+       result.num_iterations <= params.max_iterations;
+       ++result.num_iterations) {
+    const auto [price, slope] = price_and_slope(vol);
+    const double error = price - target_price;
+    if (std::abs(error) < best_error) {
+      best_error = std::abs(error);
+      result.vol = vol;
+    }
+    if (std::abs(error) <= params.price_tolerance) {
+      result.converged = true;
+      return result;
+    }
+    (error > 0 ? upper : lower) = vol;
+
+    const double newton_vol = vol - error / slope;
+    vol = slope > 0 && newton_vol > lower && newton_vol < upper
+              ? newton_vol
+              : 0.5 * (lower + upper);
+    if (upper - lower <= std::numeric_limits<double>::epsilon() * upper) {
+      break;
+    }
+  }
+  result.num_iterations = std::min(result.num_iterations,
+                                   params.max_iterations);
+  return result;
+}
+
+}  // namespace internal
+
+// The Black-Scholes vol which reproduces `price` for `option`, priced as a
+// European option (i.e. ignoring early exercise).
+inline ImpliedVolResult blackScholesImpliedVol(
+    const VanillaOption& option,
+    double price,
+    double spot,
+    double expiry_years,
+    double r,
+    double div,
+    const ImpliedVolSolverParams& params = {}) {
+  const VanillaOption european = option.asEuropean();
+  return internal::solveForVol(
+      [&](double vol) {
+        return std::pair(
+            european.blackScholes(spot, vol, expiry_years, r, div),
+            100 * european.blackScholesGreek(
+                      spot, vol, expiry_years, r, div, Greeks::Vega));
+      },
+      price,
+      0.2,
+      params);
+}
+
+// Finds, for each of `quotes`, the flat vol at which a tree with
+// `num_timesteps` steps until expiry prices the option (American or European)
+// at the quoted price. The trees are forward-propagated with `propagator`
+// (e.g. CRRPropagator or JarrowRuddPropagator, which provide the spot) as for
+// priceWithRichardsonExtrapolation.
+//
+// Each quote is solved by Newton's method (see internal::solveForVol), using
+// the tree's own vega, which is obtained by repricing on a vol-bumped tree.
+// The iteration starts from the Black-Scholes implied vol of the quote, which
+// is already close for all but deep in-the-money American options, so that
+// it typically takes two or three iterations. Quotes are independent, so they
+// are spread over `thread_pool` if one is given. Pass a foreign curve to
+// solve for currency options.
+template <typename PropagatorT>
+std::vector<ImpliedVolResult> treeImpliedVols(
+    const PropagatorT& propagator,
+    const RatesCurve& curve,
+    std::span<const OptionQuote> quotes,
+    int num_timesteps,
+    ThreadPool* thread_pool = nullptr,
+    TerminalSmoothing smoothing = TerminalSmoothing::kNone,
+    const RatesCurve* foreign_curve = nullptr,
+    const ImpliedVolSolverParams& params = {}) {
+  std::vector<ImpliedVolResult> results(quotes.size());
+  const auto solve = [&](int q) {
+    const OptionQuote& quote = quotes[q];
+    const double t = quote.expiry_years;
+
+    // The warm start, with the continuously compounded rates to the expiry.
+    const double r = -std::log(curve.df(t)) / t;
+    const double div =
+        foreign_curve == nullptr ? 0.0 : -std::log(foreign_curve->df(t)) / t;
+    const ImpliedVolResult bsm_vol = blackScholesImpliedVol(
+        quote.option, quote.price, propagator.spot(), t, r, div, params);
+
+    // Both trees are repropagated in place on every iteration.
+    StochasticTreeModel asset = createTreeForExpiry(
+        propagator, Volatility(FlatVol(bsm_vol.vol)), t, num_timesteps);
+    StochasticTreeModel bumped_asset = asset;
+    const std::unique_ptr<SingleAssetDerivative> deriv =
+        createRollingDerivative(
+            asset.binomialTree(), curve, foreign_curve, smoothing);
+    PricingWorkspace workspace;
+    results[q] = internal::solveForVol(
+        [&](double vol) {
+          asset.forwardPropagate(Volatility(FlatVol(vol)));
+          bumped_asset.forwardPropagate(
+              Volatility(FlatVol(vol + params.vega_bump)));
+          const TreeGreeks greeks =
+              deriv->priceWithGreeks(quote.option,
+                                     t,
+                                     bumped_asset.binomialTree(),
+                                     params.vega_bump,
+                                     workspace);
+          // Vega is per vol point.
+          return std::pair(greeks.price, 100 * greeks.vega.value());
+        },
+        quote.price,
+        bsm_vol.vol,
+        params);
+  };
+
+  if (thread_pool != nullptr) {
+    thread_pool->parallelFor(quotes.size(), solve);
+  } else {
+    for (size_t q = 0; q < quotes.size(); ++q) {
+      solve(q);
+    }
+  }
+  return results;
+}
+
+}  // namespace smileexplorer
+
+#endif  // SMILEEXPLORER_DERIVATIVES_IMPLIED_VOLATILITY_H_
@@ -0,0 +1,107 @@
+#include "derivatives/implied_volatility.h"
+
+#include <gtest/gtest.h>
+
+#include "rates/zero_curve.h"
+#include "trees/propagators.h"
+
+namespace smileexplorer {
+namespace {
+
+TEST(ImpliedVolatilityTest, BlackScholesRoundTrip) {
+  for (auto payoff : {OptionPayoff::Call, OptionPayoff::Put}) {
+    for (double strike : {80, 100, 125}) {
+      for (double vol : {0.1, 0.2, 0.8}) {
+        const VanillaOption option(strike, payoff);
+        const double price = option.blackScholes(100, vol, 0.5, 0.05, 0.02);
+        const auto implied =
+            blackScholesImpliedVol(option, price, 100, 0.5, 0.05, 0.02);
+        EXPECT_TRUE(implied.converged);
+        EXPECT_NEAR(vol, implied.vol, 1e-6);
+      }
+    }
+  }
+}
+
+// Quotes which the tree itself produced at known vols. (Deep in-the-money
+// American puts are left out, since they are exercised at once, whatever the
+// vol.)
+std::vector<OptionQuote> createTreeQuotes(const RatesCurve& curve,
+                                          int num_timesteps,
+                                          std::vector<double>& vols) {
+  std::vector<OptionQuote> quotes;
+  for (double expiry : {0.25, 1.0}) {
+    for (double strike : {70, 90, 100, 110}) {
+      for (auto style : {ExerciseStyle::European, ExerciseStyle::American}) {
+        const double vol = 0.1 + strike / 1000 + expiry / 10;
+        const double dt = expiry / num_timesteps;
+        StochasticTreeModel asset(BinomialTree(expiry + 2 * dt, dt),
+                                  CRRPropagator(100));
+        asset.forwardPropagate(Volatility(FlatVol(vol)));
+        SingleAssetDerivative deriv(&asset.binomialTree(), &curve);
+        const VanillaOption put(strike, OptionPayoff::Put, style);
+        quotes.push_back({put, expiry, deriv.price(put, expiry)});
+        vols.push_back(vol);
+      }
+    }
+  }
+  return quotes;
+}
+
+TEST(ImpliedVolatilityTest, RecoversTreeVols) {
+  ZeroSpotCurve curve({1.0, 10.0}, {0.05, 0.05});
+  std::vector<double> vols;
+  const auto quotes = createTreeQuotes(curve, 200, vols);
+
+  const auto results = treeImpliedVols(CRRPropagator(100), curve, quotes, 200);
+  ASSERT_EQ(quotes.size(), results.size());
+  for (size_t q = 0; q < quotes.size(); ++q) {
+    EXPECT_TRUE(results[q].converged);
+    EXPECT_NEAR(vols[q], results[q].vol, 1e-6);
+
+    // Thanks to the warm start.
+    EXPECT_LE(results[q].num_iterations, 6);
+  }
+
+  // The same, with the quotes solved in parallel.
+  ThreadPool pool(4);
+  const auto parallel_results =
+      treeImpliedVols(CRRPropagator(100), curve, quotes, 200, &pool);
+  for (size_t q = 0; q < quotes.size(); ++q) {
+    EXPECT_EQ(results[q].vol, parallel_results[q].vol);
+  }
+}
+
+TEST(ImpliedVolatilityTest, CurrencyOptions) {
+  ZeroSpotCurve domestic_curve({1.0, 10.0}, {0.05, 0.05});
+  ZeroSpotCurve foreign_curve({1.0, 10.0}, {0.02, 0.02});
+  StochasticTreeModel asset(BinomialTree(1.02, 0.01), CRRPropagator(100));
+  asset.forwardPropagate(Volatility(FlatVol(0.15)));
+  CurrencyDerivative deriv(
+      &asset.binomialTree(), &domestic_curve, &foreign_curve);
+  const VanillaOption call(105, OptionPayoff::Call, ExerciseStyle::American);
+  const OptionQuote quote{call, 1.0, deriv.price(call, 1.0)};
+
+  const auto results = treeImpliedVols(CRRPropagator(100),
+                                       domestic_curve,
+                                       std::span(&quote, 1),
+                                       100,
+                                       nullptr,
+                                       TerminalSmoothing::kNone,
+                                       &foreign_curve);
+  EXPECT_TRUE(results[0].converged);
+  EXPECT_NEAR(0.15, results[0].vol, 1e-6);
+}
+
+TEST(ImpliedVolatilityTest, UnattainablePrices) {
+  ZeroSpotCurve curve({1.0, 10.0}, {0.05, 0.05});
+  // Below the intrinsic value of an American put.
+  const OptionQuote quote{
+      VanillaOption(120, OptionPayoff::Put, ExerciseStyle::American), 1.0, 15};
+  const auto results = treeImpliedVols(
+      CRRPropagator(100), curve, std::span(&quote, 1), 100);
+  EXPECT_FALSE(results[0].converged);
+}
+
+}  // namespace
+}  // namespace smileexplorer
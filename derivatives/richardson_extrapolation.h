@@ -0,0 +1,187 @@
+#ifndef SMILEEXPLORER_DERIVATIVES_RICHARDSON_EXTRAPOLATION_H_
+#define SMILEEXPLORER_DERIVATIVES_RICHARDSON_EXTRAPOLATION_H_
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "derivatives/derivative.h"
+#include "derivatives/vanilla_option.h"
+#include "rates/rates_curve.h"
+#include "trees/binomial_tree.h"
+#include "trees/propagators.h"
+#include "trees/stochastic_tree_model.h"
+
+namespace smileexplorer {
+
+struct ExtrapolatedPrice {
+  double price;
+
+  // Distance between the extrapolated price and the one obtained with one
+  // tree fewer. This is a (usually conservative) estimate of the remaining
+  // error.
+  double error_estimate;
+};
+
+// Returns the initial timestep for which volatility.generateTimegrid places
+// `expiry_years` exactly at time index `num_timesteps`. For flat (and smile)
+// surfaces this is simply expiry_years / num_timesteps, but term-structure
+// grids adapt their timesteps to the volatility, so the initial timestep is
+// found by fixed-point iteration on the generated grid.
+template <typename VolatilityT>
+double timestepForExpiryIndex(const VolatilityT& volatility,
+                              double expiry_years,
+                              int num_timesteps) {
+  double timestep = expiry_years / num_timesteps;
+  for (int iter = 0; iter < 50; ++iter) {
+    const Timegrid timegrid = volatility.generateTimegrid(
+        expiry_years + 2 * timestep, timestep);
+    if (timegrid.size() <= num_timesteps) {
+      break;
+    }
+    const double time_at_index = timegrid.time(num_timesteps);
+    if (std::abs(time_at_index - expiry_years) <=
+        timegrid.accruedErrorEstimate() * expiry_years) {
+      break;
+    }
+    timestep *= expiry_years / time_at_index;
+  }
+  return timestep;
+}
+
+// An asset tree with `num_timesteps` steps until `expiry_years` (see
+// timestepForExpiryIndex), which is yet to be forward-propagated. As usual,
+// the tree extends slightly beyond the expiry, since the final timeslice is
+// left empty by forward propagation.
+template <typename PropagatorT, typename VolatilityT>
+StochasticTreeModel<PropagatorT> createTreeForExpiry(
+    const PropagatorT& propagator,
+    const VolatilityT& volatility,
+    double expiry_years,
+    int num_timesteps) {
+  const double dt =
+      timestepForExpiryIndex(volatility, expiry_years, num_timesteps);
+  return StochasticTreeModel(BinomialTree(expiry_years + 2 * dt, dt),
+                             propagator);
+}
+
+// A derivative with rolling timeslices on `asset_tree`, which is a
+// CurrencyDerivative if there is a foreign curve.
+inline std::unique_ptr<SingleAssetDerivative> createRollingDerivative(
+    const BinomialTree& asset_tree,
+    const RatesCurve& curve,
+    const RatesCurve* foreign_curve,
+    TerminalSmoothing smoothing) {
+  if (foreign_curve != nullptr) {
+    return std::make_unique<CurrencyDerivative>(
+        &asset_tree,
+        &curve,
+        foreign_curve,
+        BackwardInductionStorage::kRollingTimeslices,
+        smoothing);
+  }
+  return std::make_unique<SingleAssetDerivative>(
+      &asset_tree,
+      &curve,
+      BackwardInductionStorage::kRollingTimeslices,
+      smoothing);
+}
+
+// Prices `option` on a tree created by createTreeForExpiry and
+// forward-propagated under `volatility`, in `workspace`. Pass a foreign curve
+// to price a currency option.
+template <typename PropagatorT, typename VolatilityT>
+double priceOnTreeForExpiry(const PropagatorT& propagator,
+                            const VolatilityT& volatility,
+                            const RatesCurve& curve,
+                            const VanillaOption& option,
+                            double expiry_years,
+                            int num_timesteps,
+                            TerminalSmoothing smoothing,
+                            const RatesCurve* foreign_curve,
+                            PricingWorkspace& workspace) {
+  StochasticTreeModel asset = createTreeForExpiry(
+      propagator, volatility, expiry_years, num_timesteps);
+  asset.forwardPropagate(volatility);
+  return createRollingDerivative(
+             asset.binomialTree(), curve, foreign_curve, smoothing)
+      ->price(option, expiry_years, workspace);
+}
+
+// Prices `option` on `num_trees` binomial trees with num_timesteps,
+// 2 * num_timesteps, 4 * num_timesteps, ... steps until expiry, and combines
+// the prices by Richardson extrapolation, assuming that the tree error has an
+// expansion in powers of 1 / N. Two trees cancel the O(1/N) term and three
+// trees also cancel the O(1/N^2) term.
+//
+// The trees are generated by forward-propagating `propagator` under
+// `volatility` as usual (see priceOnTreeForExpiry), so their timegrids follow
+// Volatility::generateTimegrid (e.g. term-structure trees keep their
+// variable timesteps), with the expiry placed exactly on a timeslice. Pass a
+// foreign curve to price a currency option.
+//
+// Step counts are rounded up to the next even number, so that every tree has
+// the same parity and the odd/even oscillation of binomial prices does not
+// pollute the extrapolation. Without smoothing, the error is only a smooth
+// function of N if the strike falls on a node (e.g. at the money); otherwise
+// it also oscillates with the position of the strike between nodes. Pass
+// TerminalSmoothing::kBlackScholes to remove that oscillation (the so-called
+// BBSR method).
+//
+// LeisenReimerPropagator is not supported: it needs an odd number of steps to
+// centre the strike, and its error is already O(1/N^2), so the first level
+// would cancel an O(1/N) term which it does not have. Use priceToAccuracy,
+// which keeps the parity of the step counts, instead.
+template <typename PropagatorT, typename VolatilityT>
+ExtrapolatedPrice priceWithRichardsonExtrapolation(
+    const PropagatorT& propagator,
+    const VolatilityT& volatility,
+    const RatesCurve& curve,
+    const VanillaOption& option,
+    double expiry_years,
+    int num_timesteps,
+    int num_trees = 2,
+    TerminalSmoothing smoothing = TerminalSmoothing::kNone,
+    const RatesCurve* foreign_curve = nullptr) {
+  static_assert(!std::is_same_v<PropagatorT, LeisenReimerPropagator>,
+                "Leisen-Reimer trees need odd step counts and have no O(1/N) "
+                "error term to extrapolate away; use priceToAccuracy.");
+  num_trees = std::max(num_trees, 2);
+  num_timesteps = std::max(2, num_timesteps + num_timesteps % 2);
+
+  // Neville-style tableau: extrapolations[k] holds the estimate which cancels
+  // the first k error terms, using the finest k + 1 trees so far.
+  std::vector<double> extrapolations(num_trees);
+  double error_estimate = 0.0;
+  PricingWorkspace workspace;
+  for (int level = 0; level < num_trees; ++level) {
+    const double price = priceOnTreeForExpiry(propagator,
+                                              volatility,
+                                              curve,
+                                              option,
+                                              expiry_years,
+                                              num_timesteps << level,
+                                              smoothing,
+                                              foreign_curve,
+                                              workspace);
+
+    // Halving the timestep scales the k-th error term by 2^-k.
+    double refined = price;
+    for (int k = 1; k <= level; ++k) {
+      const double coarser = extrapolations[k - 1];
+      extrapolations[k - 1] = refined;
+      refined += (refined - coarser) / ((1 << k) - 1);
+    }
+    if (level > 0) {
+      error_estimate = std::abs(refined - extrapolations[level - 1]);
+    }
+    extrapolations[level] = refined;
+  }
+  return {extrapolations.back(), error_estimate};
+}
+
+}  // namespace smileexplorer
+
+#endif  // SMILEEXPLORER_DERIVATIVES_RICHARDSON_EXTRAPOLATION_H_
@@ -0,0 +1,134 @@
+#include "derivatives/richardson_extrapolation.h"
+
+#include <gtest/gtest.h>
+
+#include "rates/zero_curve.h"
+#include "trees/propagators.h"
+#include "volatility/volatility.h"
+
+namespace smileexplorer {
+namespace {
+
+// Vol rising linearly from 15% to 25% over the first year.
+struct LinearTermStructureVol {
+  static constexpr VolSurfaceFnType type = VolSurfaceFnType::kTermStructure;
+  double operator()(double t) const { return 0.15 + 0.1 * t; }
+};
+
+TEST(RichardsonExtrapolationTest, ExpiryFallsOnTimegrid) {
+  Volatility flat_vol(FlatVol(0.2));
+  EXPECT_DOUBLE_EQ(0.01, timestepForExpiryIndex(flat_vol, 1.0, 100));
+
+  Volatility term_structure_vol{LinearTermStructureVol()};
+  const double dt = timestepForExpiryIndex(term_structure_vol, 1.0, 100);
+  const auto timegrid = term_structure_vol.generateTimegrid(1.0 + 2 * dt, dt);
+  EXPECT_NEAR(1.0, timegrid.time(100), 1e-12);
+  EXPECT_EQ(100, timegrid.getTimeIndexForExpiry(1.0));
+}
+
+TEST(RichardsonExtrapolationTest, BeatsTenTimesMoreSteps) {
+  ZeroSpotCurve curve({1.0, 10.0}, {0.05, 0.05});
+  Volatility flat_vol(FlatVol(0.2));
+
+  // A plain tree with 1000 steps.
+  StochasticTreeModel asset(BinomialTree(1.002, 0.001), CRRPropagator(100));
+  asset.forwardPropagate(flat_vol);
+  SingleAssetDerivative deriv(&asset.binomialTree(), &curve);
+
+  for (auto payoff : {OptionPayoff::Call, OptionPayoff::Put}) {
+    const VanillaOption option(100, payoff);
+    const double bsm = option.blackScholes(100, 0.2, 1.0, 0.05, 0.0);
+    const double plain_error = std::abs(deriv.price(option, 1.0) - bsm);
+
+    // Trees with 100 and 200 steps.
+    const auto extrapolated = priceWithRichardsonExtrapolation(
+        CRRPropagator(100), flat_vol, curve, option, 1.0, 100);
+    const double error = std::abs(extrapolated.price - bsm);
+    EXPECT_LT(error, plain_error / 10);
+    EXPECT_LT(error, extrapolated.error_estimate);
+
+    // A third tree cancels the next error term too.
+    const auto extrapolated3 = priceWithRichardsonExtrapolation(
+        CRRPropagator(100), flat_vol, curve, option, 1.0, 50, 3);
+    EXPECT_NEAR(bsm, extrapolated3.price, 1e-6);
+  }
+}
+
+TEST(RichardsonExtrapolationTest, SmoothedTreesForAnyStrike) {
+  ZeroSpotCurve curve({1.0, 10.0}, {0.05, 0.05});
+  Volatility flat_vol(FlatVol(0.2));
+
+  for (double strike : {90.0, 97.5, 105.0, 110.0}) {
+    const VanillaOption put(strike, OptionPayoff::Put);
+    const auto european = priceWithRichardsonExtrapolation(
+        CRRPropagator(100),
+        flat_vol,
+        curve,
+        put,
+        1.0,
+        50,
+        2,
+        TerminalSmoothing::kBlackScholes);
+    EXPECT_NEAR(
+        put.blackScholes(100, 0.2, 1.0, 0.05, 0.0), european.price, 2e-4);
+
+    const VanillaOption american_put(
+        strike, OptionPayoff::Put, ExerciseStyle::American);
+    const auto american = priceWithRichardsonExtrapolation(
+        CRRPropagator(100),
+        flat_vol,
+        curve,
+        american_put,
+        1.0,
+        100,
+        2,
+        TerminalSmoothing::kBlackScholes);
+    const auto reference = priceWithRichardsonExtrapolation(
+        CRRPropagator(100),
+        flat_vol,
+        curve,
+        american_put,
+        1.0,
+        2000,
+        2,
+        TerminalSmoothing::kBlackScholes);
+    EXPECT_NEAR(reference.price, american.price, 1e-3);
+  }
+}
+
+TEST(RichardsonExtrapolationTest, TermStructureAndCurrencyTrees) {
+  ZeroSpotCurve domestic_curve({1.0, 10.0}, {0.05, 0.05});
+  ZeroSpotCurve foreign_curve({1.0, 10.0}, {0.02, 0.02});
+  const VanillaOption call(100, OptionPayoff::Call);
+
+  // The variance of the linear term structure is integrated exactly.
+  const double implied_vol =
+      std::sqrt((std::pow(0.25, 3) - std::pow(0.15, 3)) / (3 * 0.1));
+  const auto term_structure_price =
+      priceWithRichardsonExtrapolation(CRRPropagator(100),
+                                       Volatility(LinearTermStructureVol()),
+                                       domestic_curve,
+                                       call,
+                                       1.0,
+                                       100);
+  EXPECT_NEAR(call.blackScholes(100, implied_vol, 1.0, 0.05, 0.0),
+              term_structure_price.price,
+              1e-4);
+
+  const auto fx_price =
+      priceWithRichardsonExtrapolation(CRRPropagator(100),
+                                       Volatility(FlatVol(0.2)),
+                                       domestic_curve,
+                                       call,
+                                       1.0,
+                                       100,
+                                       2,
+                                       TerminalSmoothing::kNone,
+                                       &foreign_curve);
+  EXPECT_NEAR(call.blackScholes(100, 0.2, 1.0, foreign_curve, domestic_curve),
+              fx_price.price,
+              1e-4);
+}
+
+}  // namespace
+}  // namespace smileexplorer
@@ -0,0 +1,136 @@
+#ifndef SMILEEXPLORER_DERIVATIVES_THREAD_POOL_H_
+#define SMILEEXPLORER_DERIVATIVES_THREAD_POOL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace smileexplorer {
+
+// A fixed set of worker threads for fine-grained data parallelism, such as
+// splitting each timeslice of a backward induction into blocks of nodes.
+// Such jobs are short (microseconds) and follow each other closely, so idle
+// workers spin for a while before going to sleep, rather than paying for a
+// wake-up on every job.
+class ThreadPool {
+ public:
+  // The calling thread takes part in every job, so `num_threads` includes
+  // it, and a pool of one thread runs everything serially.
+  explicit ThreadPool(int num_threads = std::thread::hardware_concurrency()) {
+    for (int t = 1; t < num_threads; ++t) {
+      workers_.emplace_back([this] { workerLoop(); });
+    }
+  }
+
+  ~ThreadPool() {
+    stopping_ = true;
+    generation_.fetch_add(1);
+    generation_.notify_all();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  int numThreads() const { return workers_.size() + 1; }
+
+  // Calls fn(task) for every task in [0, num_tasks), spread over the pool,
+  // and returns once they have all completed. Jobs submitted from several
+  // threads at once are run one after the other. Jobs submitted from within
+  // a task of this pool (e.g. pricing a derivative which uses the pool, in a
+  // job on the same pool) run inline on the submitting thread, since the
+  // pool is busy with the outer job.
+  template <typename FnT>
+  void parallelFor(int num_tasks, FnT&& fn) {
+    if (workers_.empty() || num_tasks <= 1 || currentPool() == this) {
+      for (int task = 0; task < num_tasks; ++task) {
+        fn(task);
+      }
+      return;
+    }
+
+    std::lock_guard lock(job_mutex_);
+    job_fn_ = [](void* context, int task) {
+      (*static_cast<std::remove_reference_t<FnT>*>(context))(task);
+    };
+    job_context_ = const_cast<void*>(static_cast<const void*>(&fn));
+    num_tasks_ = num_tasks;
+    next_task_ = 0;
+    num_idle_workers_ = 0;
+    generation_.fetch_add(1);
+    generation_.notify_all();
+
+    runTasks();
+
+    // Workers only touch the job while they are not idle, so the job may be
+    // released once all of them are.
+    const int num_workers = workers_.size();
+    for (int idle = num_idle_workers_.load(); idle < num_workers;
+         idle = num_idle_workers_.load()) {
+      num_idle_workers_.wait(idle);
+    }
+  }
+
+ private:
+  // Roughly how long an idle worker keeps spinning for the next job.
+  static constexpr int kSpinIterations = 20000;
+
+  std::vector<std::thread> workers_;
+  std::mutex job_mutex_;
+
+  // The current job, type-erased without any allocation.
+  void (*job_fn_)(void*, int) = nullptr;
+  void* job_context_ = nullptr;
+  int num_tasks_ = 0;
+  std::atomic<int> next_task_ = 0;
+  std::atomic<int> num_idle_workers_ = 0;
+
+  // Incremented for every job (and on shutdown).
+  std::atomic<uint64_t> generation_ = 0;
+  std::atomic<bool> stopping_ = false;
+
+  // The pool whose tasks the current thread is running, if any.
+  static const ThreadPool*& currentPool() {
+    thread_local const ThreadPool* current_pool = nullptr;
+    return current_pool;
+  }
+
+  void runTasks() {
+    const ThreadPool* outer_pool = std::exchange(currentPool(), this);
+    for (int task = next_task_.fetch_add(1); task < num_tasks_;
+         task = next_task_.fetch_add(1)) {
+      job_fn_(job_context_, task);
+    }
+    currentPool() = outer_pool;
+  }
+
+  void workerLoop() {
+    uint64_t seen_generation = 0;
+    while (true) {
+      for (int spin = 0;
+           spin < kSpinIterations && generation_.load() == seen_generation;
+           ++spin) {
+        std::this_thread::yield();
+      }
+      generation_.wait(seen_generation);
+      seen_generation = generation_.load();
+      if (stopping_) {
+        return;
+      }
+      runTasks();
+      num_idle_workers_.fetch_add(1);
+      num_idle_workers_.notify_one();
+    }
+  }
+};
+
+}  // namespace smileexplorer
+
+#endif  // SMILEEXPLORER_DERIVATIVES_THREAD_POOL_H_
@@ -0,0 +1,68 @@
+#include "derivatives/thread_pool.h"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+namespace smileexplorer {
+namespace {
+
+TEST(ThreadPoolTest, RunsEveryTaskOnce) {
+  for (int num_threads : {1, 2, 4}) {
+    ThreadPool pool(num_threads);
+    EXPECT_EQ(num_threads, pool.numThreads());
+
+    // Many short jobs in a row, as in a backward induction.
+    for (int job = 0; job < 1000; ++job) {
+      const int num_tasks = job % 17;
+      std::vector<int> runs(num_tasks, 0);
+      pool.parallelFor(num_tasks, [&](int task) { ++runs[task]; });
+      EXPECT_EQ(std::vector<int>(num_tasks, 1), runs);
+    }
+  }
+}
+
+TEST(ThreadPoolTest, JobsFromSeveralThreads) {
+  ThreadPool pool(3);
+  std::vector<std::vector<int>> sums(4, std::vector<int>(100, 0));
+  std::vector<std::thread> submitters;
+  for (int s = 0; s < std::ssize(sums); ++s) {
+    submitters.emplace_back([&, s] {
+      for (int job = 0; job < 100; ++job) {
+        std::vector<int> values(64, 0);
+        pool.parallelFor(values.size(), [&](int task) { values[task] = task; });
+        for (int value : values) {
+          sums[s][job] += value;
+        }
+      }
+    });
+  }
+  for (auto& submitter : submitters) {
+    submitter.join();
+  }
+  for (const auto& job_sums : sums) {
+    EXPECT_EQ(std::vector<int>(100, 63 * 64 / 2), job_sums);
+  }
+}
+
+TEST(ThreadPoolTest, NestedJobsRunInline) {
+  ThreadPool pool(4);
+  ThreadPool other_pool(2);
+  std::vector<std::vector<int>> runs(16, std::vector<int>(32, 0));
+  pool.parallelFor(runs.size(), [&](int outer_task) {
+    auto& inner_runs = runs[outer_task];
+    pool.parallelFor(inner_runs.size() / 2,
+                     [&](int task) { ++inner_runs[task]; });
+
+    // Other pools are still used as usual.
+    other_pool.parallelFor(inner_runs.size() / 2, [&](int task) {
+      ++inner_runs[inner_runs.size() / 2 + task];
+    });
+  });
+  for (const auto& inner_runs : runs) {
+    EXPECT_EQ(std::vector<int>(32, 1), inner_runs);
+  }
+}
+
+}  // namespace
+}  // namespace smileexplorer
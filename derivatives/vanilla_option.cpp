@@ -46,32 +46,18 @@ double VanillaOption::blackScholesGreek(double spot,
   }
 }
 
-double VanillaOption::operator()(const BinomialTree& deriv_tree,
-                                 const BinomialTree& asset_tree,
-                                 int ti,
-                                 int i,
-                                 int ti_final,
-                                 double up_prob,
-                                 double fwd_df) const {
-  if (ti == ti_final) {
-    const double state = asset_tree.nodeValue(ti, i);
-    return getPayoff(state, strike_);
-  }
-
-  const double up = deriv_tree.nodeValue(ti + 1, i + 1);
-  const double down = deriv_tree.nodeValue(ti + 1, i);
-  const double down_prob = 1 - up_prob;
-
-  const double discounted_expected_next_state =
-      fwd_df * (up * up_prob + down * down_prob);
-
-  if (style_ == ExerciseStyle::American) {
-    const double state = asset_tree.nodeValue(ti, i);
-    const double payoff_if_early_exercise = getPayoff(state, strike_);
-    return std::max(payoff_if_early_exercise, discounted_expected_next_state);
+void VanillaOption::blackScholesTimeslice(
+    const Eigen::Ref<const Eigen::ArrayXd>& states,
+    const Eigen::Ref<const Eigen::ArrayXd>& vols,
+    double t,
+    double r,
+    double div,
+    Eigen::Ref<Eigen::ArrayXd> out) const {
+  for (Eigen::Index i = 0; i < states.size(); ++i) {
+    out[i] = payoff_ == OptionPayoff::Call
+                 ? call(states[i], strike_, vols[i], t, r, div)
+                 : put(states[i], strike_, vols[i], t, r, div);
   }
-
-  return discounted_expected_next_state;
 }
 
 double VanillaOption::operator()(const TrinomialTree& deriv_tree,
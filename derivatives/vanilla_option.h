@@ -1,6 +1,8 @@
 #ifndef SMILEEXPLORER_DERIVATIVES_VANILLA_OPTION_H_
 #define SMILEEXPLORER_DERIVATIVES_VANILLA_OPTION_H_
 
+#include <Eigen/Dense>
+
 #include "instruments/swaps/interest_rate_swap.h"
 #include "trees/binomial_tree.h"
 #include "trees/trinomial_tree.h"
@@ -17,6 +19,19 @@ struct VanillaOption {
                 ExerciseStyle style = ExerciseStyle::European)
       : strike_(strike), payoff_(payoff), style_(style) {}
 
+  double strike() const { return strike_; }
+  bool isCall() const { return payoff_ == OptionPayoff::Call; }
+
+  // The same option with a different strike.
+  VanillaOption withStrike(double strike) const {
+    return VanillaOption(strike, payoff_, style_);
+  }
+
+  // The same option without early exercise.
+  VanillaOption asEuropean() const {
+    return VanillaOption(strike_, payoff_, ExerciseStyle::European);
+  }
+
   double blackScholes(
       double spot, double vol, double t, double r, double div) const;
 
@@ -50,13 +65,30 @@ struct VanillaOption {
     return blackScholesGreek(spot, vol, t, r_dom, r_for, greek);
   }
 
-  double operator()(const BinomialTree& deriv_tree,
-                    const BinomialTree& asset_tree,
-                    int ti,
-                    int i,
-                    int ti_final,
-                    double up_prob,
-                    double fwd_df) const;
+  // Row-wise interface used by binomial backward induction, so that entire
+  // timeslices are evaluated as (vectorisable) Eigen array expressions.
+  template <typename StatesT>
+  auto payoff(const Eigen::ArrayBase<StatesT>& states) const {
+    const double sign = payoff_ == OptionPayoff::Call ? 1.0 : -1.0;
+    return (sign * (states - strike_)).max(0.0);
+  }
+  bool hasEarlyExercise() const { return style_ == ExerciseStyle::American; }
+
+  // Calls `fn` with the StaticVanillaOption for this option, so that a whole
+  // backward induction can run on the instantiation for its payoff and
+  // exercise style, at the cost of a single branch.
+  template <typename FnT>
+  decltype(auto) dispatch(FnT&& fn) const;
+
+  // Closed-form European value over a (short) period `t` from each of
+  // `states`, with a volatility per state, written into `out`. Early exercise
+  // is ignored. Used to smooth the last step of binomial backward induction.
+  void blackScholesTimeslice(const Eigen::Ref<const Eigen::ArrayXd>& states,
+                             const Eigen::Ref<const Eigen::ArrayXd>& vols,
+                             double t,
+                             double r,
+                             double div,
+                             Eigen::Ref<Eigen::ArrayXd> out) const;
 
   double operator()(const TrinomialTree& deriv_tree,
                     const InterestRateSwap& underlying,
@@ -76,6 +108,60 @@ struct VanillaOption {
   }
 };
 
+// A VanillaOption whose payoff and exercise style are fixed at compile time.
+// It has the same row-wise interface, but the terminal payoff compiles to a
+// single array expression and hasEarlyExercise() to a constant, so the
+// branches drop out of the rollback of every interior timeslice.
+template <OptionPayoff kPayoff, ExerciseStyle kStyle>
+class StaticVanillaOption {
+ public:
+  explicit StaticVanillaOption(const VanillaOption& option) : option_(option) {}
+
+  double strike() const { return option_.strike(); }
+
+  template <typename StatesT>
+  auto payoff(const Eigen::ArrayBase<StatesT>& states) const {
+    if constexpr (kPayoff == OptionPayoff::Call) {
+      return (states - option_.strike()).max(0.0);
+    } else {
+      return (option_.strike() - states).max(0.0);
+    }
+  }
+  static constexpr bool hasEarlyExercise() {
+    return kStyle == ExerciseStyle::American;
+  }
+
+  void blackScholesTimeslice(const Eigen::Ref<const Eigen::ArrayXd>& states,
+                             const Eigen::Ref<const Eigen::ArrayXd>& vols,
+                             double t,
+                             double r,
+                             double div,
+                             Eigen::Ref<Eigen::ArrayXd> out) const {
+    option_.blackScholesTimeslice(states, vols, t, r, div, out);
+  }
+
+ private:
+  VanillaOption option_;
+};
+
+template <typename FnT>
+decltype(auto) VanillaOption::dispatch(FnT&& fn) const {
+  constexpr auto kCall = OptionPayoff::Call;
+  constexpr auto kPut = OptionPayoff::Put;
+  constexpr auto kAmerican = ExerciseStyle::American;
+  constexpr auto kEuropean = ExerciseStyle::European;
+  if (payoff_ == kCall) {
+    if (style_ == kAmerican) {
+      return fn(StaticVanillaOption<kCall, kAmerican>(*this));
+    }
+    return fn(StaticVanillaOption<kCall, kEuropean>(*this));
+  }
+  if (style_ == kAmerican) {
+    return fn(StaticVanillaOption<kPut, kAmerican>(*this));
+  }
+  return fn(StaticVanillaOption<kPut, kEuropean>(*this));
+}
+
 }  // namespace smileexplorer
 
 #endif  // SMILEEXPLORER_DERIVATIVES_VANILLA_OPTION_H_
\ No newline at end of file
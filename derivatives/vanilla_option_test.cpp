@@ -59,5 +59,19 @@ TEST(VanillaOptionTest, CurrencyOptions) {
       0.000005);
 }
 
+TEST(VanillaOptionTest, DispatchesToStaticPayoffs) {
+  const Eigen::ArrayXd states{{80.5, 99.5, 100.5, 120.5}};
+  for (OptionPayoff payoff : {OptionPayoff::Call, OptionPayoff::Put}) {
+    for (ExerciseStyle style :
+         {ExerciseStyle::European, ExerciseStyle::American}) {
+      const VanillaOption vanilla(100, payoff, style);
+      vanilla.dispatch([&](const auto& option) {
+        EXPECT_EQ(style == ExerciseStyle::American, option.hasEarlyExercise());
+        EXPECT_TRUE((option.payoff(states) == vanilla.payoff(states)).all());
+      });
+    }
+  }
+}
+
 }  // namespace
 }  // namespace smileexplorer
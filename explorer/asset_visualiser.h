@@ -3,7 +3,9 @@
 #define SMILEEXPLORER_EXPLORER_ASSET_VISUALISER_
 
 #include <algorithm>
+#include <cmath>
 #include <optional>
+#include <type_traits>
 
 #include "derivatives/derivative.h"
 #include "explorer_params.h"
@@ -212,21 +214,51 @@ struct PanelParamsSnapshot {
   Currency currency = Currency::USD;
   Currency foreign_currency = Currency::EUR;
 
+  // Leisen-Reimer trees are built for the option's strike and expiry, so
+  // these are only set for them; other trees need no rebuild when they move.
+  float option_expiry = 0.f;
+  float option_strike = 0.f;
+
   bool operator==(const PanelParamsSnapshot&) const = default;
 
+  template <typename FwdPropT>
   static PanelParamsSnapshot from(const ExplorerParams& p) {
-    return {p.asset_tree_duration,
-            p.asset_tree_timestep,
-            p.spot_price,
-            p.jarrowrudd_expected_drift,
-            p.flat_vol,
-            p.sigmoid_vol_range,
-            p.sigmoid_vol_stretch,
-            p.currency,
-            p.foreign_currency};
+    PanelParamsSnapshot snapshot{p.asset_tree_duration,
+                                 p.asset_tree_timestep,
+                                 p.spot_price,
+                                 p.jarrowrudd_expected_drift,
+                                 p.flat_vol,
+                                 p.sigmoid_vol_range,
+                                 p.sigmoid_vol_stretch,
+                                 p.currency,
+                                 p.foreign_currency};
+    if constexpr (std::is_same_v<FwdPropT, LeisenReimerPropagator>) {
+      snapshot.option_expiry = p.option_expiry;
+      snapshot.option_strike = p.option_strike;
+    }
+    return snapshot;
   }
 };
 
+// The timestep of the asset tree. Leisen-Reimer trees need an odd number of
+// timesteps until the option's expiry (see LeisenReimerPropagator), so theirs
+// is adjusted to the nearest such timestep.
+template <typename FwdPropT>
+double assetTreeTimestep(const ExplorerParams& params) {
+  if constexpr (std::is_same_v<FwdPropT, LeisenReimerPropagator>) {
+    if (params.option_expiry > 0) {
+      long num_timesteps = std::max(
+          1L,
+          std::lround(params.option_expiry / params.asset_tree_timestep));
+      if (num_timesteps % 2 == 0) {
+        ++num_timesteps;
+      }
+      return params.option_expiry / num_timesteps;
+    }
+  }
+  return params.asset_tree_timestep;
+}
+
 template <typename FwdPropT, typename VolFunctorT, typename DerivativeT>
 void displayPairedAssetDerivativePanel(std::string_view window_name,
                                        ExplorerParams& prop_params) {
@@ -239,18 +271,28 @@ void displayPairedAssetDerivativePanel(std::string_view window_name,
   // Cached model state — rebuilt only when parameters change.
   // Because this is a function template, each instantiation
   // <FwdPropT, VolFunctorT, DerivativeT> owns its own independent set of
-  // statics, so the five panels in main() do not interfere with each other.
+  // statics, so the panels in main() do not interfere with each other.
   static std::optional<StochasticTreeModel<FwdPropT>> s_asset;
   static std::optional<Volatility<VolFunctorT>> s_vol_surface;
   static std::optional<DerivativeT> s_deriv;
   static PanelParamsSnapshot s_last_snapshot;
 
   const PanelParamsSnapshot current_snapshot =
-      PanelParamsSnapshot::from(prop_params);
+      PanelParamsSnapshot::from<FwdPropT>(prop_params);
+
+  // Trees which scale with the spot are just rescaled when only the spot moves.
+  PanelParamsSnapshot spot_moved_snapshot = s_last_snapshot;
+  spot_moved_snapshot.spot_price = current_snapshot.spot_price;
+  if (s_asset.has_value() && current_snapshot != s_last_snapshot &&
+      current_snapshot == spot_moved_snapshot &&
+      s_asset->updateSpot(prop_params.spot_price)) {
+    s_last_snapshot = current_snapshot;
+  }
+
   if (!s_asset.has_value() || current_snapshot != s_last_snapshot) {
     s_vol_surface.emplace(prop_params);
     BinomialTree binomial_tree(prop_params.asset_tree_duration,
-                               prop_params.asset_tree_timestep);
+                               assetTreeTimestep<FwdPropT>(prop_params));
     s_asset.emplace(std::move(binomial_tree),
                     createDefaultPropagator<FwdPropT>(prop_params));
     s_asset->forwardPropagate(*s_vol_surface);
@@ -348,7 +390,7 @@ void displayPairedAssetDerivativePanel(std::string_view window_name,
 
     plotProbabilityDistribution("Arrow-Debreu prices",
                                 s_asset->binomialTree(),
-                                s_deriv->arrowDebreuTree(),
+                                *s_deriv->arrowDebreuTree(),
                                 time_index);
 
     ImGui::TreePop();
@@ -104,6 +104,10 @@ int main(int, char**) {
                                                &global_currencies);
   smileexplorer::ExplorerParams localvol_prop_params(&global_rates,
                                                      &global_currencies);
+  smileexplorer::ExplorerParams lr_prop_params(&global_rates,
+                                               &global_currencies);
+  smileexplorer::ExplorerParams tian_prop_params(&global_rates,
+                                                 &global_currencies);
   smileexplorer::ExplorerParams tarf_params(&global_rates, &global_currencies);
 
   while (!glfwWindowShouldClose(window)) {
@@ -158,6 +162,20 @@ int main(int, char**) {
         smileexplorer::ConstantVolSurface,
         smileexplorer::CurrencyDerivative>("FX options", jr_prop_params);
 
+    ImGui::SetNextWindowPos(ImVec2(10, window_spacing * 6));
+    smileexplorer::displayPairedAssetDerivativePanel<
+        smileexplorer::LeisenReimerPropagator,
+        smileexplorer::ConstantVolSurface,
+        smileexplorer::SingleAssetDerivative>("Leisen-Reimer convention",
+                                              lr_prop_params);
+
+    ImGui::SetNextWindowPos(ImVec2(10, window_spacing * 7));
+    smileexplorer::displayPairedAssetDerivativePanel<
+        smileexplorer::TianPropagator,
+        smileexplorer::ConstantVolSurface,
+        smileexplorer::SingleAssetDerivative>("Tian convention",
+                                              tian_prop_params);
+
     ImGui::Render();
     int display_w, display_h;
     glfwGetFramebufferSize(window, &display_w, &display_h);
@@ -29,6 +29,21 @@ createDefaultPropagator<LocalVolatilityPropagator>(
   return LocalVolatilityPropagator(*params.curve(), params.spot_price);
 }
 
+template <>
+inline LeisenReimerPropagator createDefaultPropagator<LeisenReimerPropagator>(
+    const ExplorerParams& params) {
+  return LeisenReimerPropagator(*params.curve(),
+                                params.spot_price,
+                                params.option_strike,
+                                params.option_expiry);
+}
+
+template <>
+inline TianPropagator createDefaultPropagator<TianPropagator>(
+    const ExplorerParams& params) {
+  return TianPropagator(*params.curve(), params.spot_price);
+}
+
 }  // namespace smileexplorer
 
 #endif  // SMILEEXPLORER_EXPLORER_PROPAGATOR_FACTORIES_
\ No newline at end of file
@@ -1,6 +1,8 @@
 #ifndef SMILEEXPLORER_RATES_RATES_CURVE_H_
 #define SMILEEXPLORER_RATES_RATES_CURVE_H_
 
+#include <atomic>
+#include <cstdint>
 #include <utility>  // std::pair
 
 #include "curve_calculators.h"
@@ -42,6 +44,23 @@ class RatesCurve {
   double inverseForwardDF(double start_time, double end_time) const {
     return df(start_time) / df(end_time);
   }
+
+  // Changes whenever the curve is modified. Versions are unique across all
+  // curves (only a copy shares the version of its original, until either is
+  // modified), so that results derived from a curve can be cached.
+  uint64_t version() const { return version_; }
+
+ protected:
+  // To be called by subclasses whenever the curve changes.
+  void markModified() { version_ = nextVersion(); }
+
+ private:
+  static uint64_t nextVersion() {
+    static std::atomic<uint64_t> next_version = 1;
+    return next_version++;
+  }
+
+  uint64_t version_ = nextVersion();
 };
 
 // Only used for testing. This can be moved to the test lib (along with other
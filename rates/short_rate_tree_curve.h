@@ -69,12 +69,17 @@ class ShortRateTreeCurve : public RatesCurve {
   }
 
   const TrinomialTree& trinomialTree() const { return trinomial_tree_; }
-  TrinomialTree& trinomialTree() { return trinomial_tree_; }
+  // The tree may be modified through this, so the curve counts as modified.
+  TrinomialTree& trinomialTree() {
+    markModified();
+    return trinomial_tree_;
+  }
 
   void forwardPropagate(const HullWhitePropagator& propagator,
                         const ZeroSpotCurve& market_curve) {
     firstStage(propagator);
     secondStage(propagator, market_curve);
+    markModified();
   }
 
  private:
@@ -77,6 +77,7 @@ class ZeroSpotCurve : public RatesCurve {
     rates_[mat_index] = updated_rate;
     updateSpline();
     computeCurve();
+    markModified();
   }
 
   const std::vector<double>& getInputRates() const { return rates_; }
@@ -0,0 +1,168 @@
+#ifndef SMILEEXPLORER_TREES_BINOMIAL_TRANSITION_TABLE_H_
+#define SMILEEXPLORER_TREES_BINOMIAL_TRANSITION_TABLE_H_
+
+#include <Eigen/Dense>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "absl/log/log.h"
+#include "rates/rates_curve.h"
+#include "trees/binomial_tree.h"
+
+namespace smileexplorer {
+
+// Per-timestep forward discount factors and risk-neutral growth factors of a
+// binomial tree under a discount curve (and, for currency trees, a foreign
+// curve). The curve lookups are done once per timestep when the table is
+// updated, so that backward induction and Arrow-Debreu propagation only need
+// cheap arithmetic on the node values to recover the up-probabilities.
+class BinomialTransitionTable {
+ public:
+  // Rebuilds the table for the current timegrid of `tree`, unless neither the
+  // tree nor the curves have changed since the last update (see
+  // BinomialTree::version and RatesCurve::version). Reuses the existing
+  // allocation wherever possible. Logs a warning if any up-probability of the
+  // tree is outside (0, 1), i.e. if the no-arbitrage condition is violated.
+  void update(const BinomialTree& tree,
+              const RatesCurve& curve,
+              const RatesCurve* foreign_curve = nullptr) {
+    const Inputs inputs{
+        .tree = tree.version(),
+        .curve = curve.version(),
+        .foreign_curve = foreign_curve == nullptr
+                             ? std::nullopt
+                             : std::optional(foreign_curve->version())};
+    if (inputs_ == inputs) {
+      return;
+    }
+    inputs_ = inputs;
+    ++num_updates_;
+
+    const auto& timegrid = tree.getTimegrid();
+    const int num_transitions = timegrid.size() - 1;
+    fwd_dfs_.resize(num_transitions);
+    growth_factors_.resize(num_transitions);
+    cumulative_dfs_.resize(num_transitions + 1);
+    cumulative_growth_.resize(num_transitions + 1);
+    cumulative_dfs_[0] = 1.0;
+    cumulative_growth_[0] = 1.0;
+
+    for (int t = 0; t < num_transitions; ++t) {
+      const double t_start = timegrid.time(t);
+      const double t_end = timegrid.time(t + 1);
+      fwd_dfs_[t] = curve.forwardDF(t_start, t_end);
+
+      double growth = curve.inverseForwardDF(t_start, t_end);
+      if (foreign_curve != nullptr) {
+        growth /= foreign_curve->inverseForwardDF(t_start, t_end);
+      }
+      growth_factors_[t] = growth;
+      cumulative_dfs_[t + 1] = cumulative_dfs_[t] * fwd_dfs_[t];
+      cumulative_growth_[t + 1] = cumulative_growth_[t] * growth;
+    }
+
+    arbitrage_free_ = checkUpProbs(tree);
+    if (!arbitrage_free_) {
+      LOG(WARNING) << "No-arbitrage condition violated as risk-neutral up-prob "
+                      "is outside the range (0,1).";
+    }
+  }
+
+  // False if the last update found an up-probability outside (0, 1).
+  bool isArbitrageFree() const { return arbitrage_free_; }
+
+  // The number of times the table has been rebuilt. Exposed for testing.
+  int numUpdates() const { return num_updates_; }
+
+  // Forward discount factor from time index t to t + 1.
+  double forwardDF(int t) const { return fwd_dfs_[t]; }
+
+  // Risk-neutral expected growth of the asset from time index t to t + 1
+  // (i.e. the inverse forward discount factor, adjusted for the foreign rate
+  // in the case of currencies).
+  double growthFactor(int t) const { return growth_factors_[t]; }
+
+  // The same, compounded over every timestep from t_start to t_end.
+  double forwardDF(int t_start, int t_end) const {
+    return cumulative_dfs_[t_end] / cumulative_dfs_[t_start];
+  }
+  double growthFactor(int t_start, int t_end) const {
+    return cumulative_growth_[t_end] / cumulative_growth_[t_start];
+  }
+
+  // Equivalent to BinomialTree::getUpProbAt, but without any curve lookups.
+  double upProb(const BinomialTree& tree, int t, int i) const {
+    const double curr = tree.nodeValue(t, i);
+    const double up_ratio = tree.nodeValue(t + 1, i + 1) / curr;
+    const double down_ratio = tree.nodeValue(t + 1, i) / curr;
+    return (growth_factors_[t] - down_ratio) / (up_ratio - down_ratio);
+  }
+
+  // upProb for a range of n nodes in the timeslice at t, as an Eigen array
+  // expression, given their states and the n + 1 states they lead to at t + 1
+  // (see BinomialTree::copyTimeslice).
+  template <typename StatesT, typename NextStatesT>
+  auto upProbs(int t,
+               const Eigen::ArrayBase<StatesT>& states,
+               const Eigen::ArrayBase<NextStatesT>& next_states) const {
+    const auto up_ratio = next_states.tail(states.size()) / states;
+    const auto down_ratio = next_states.head(states.size()) / states;
+    return (growth_factors_[t] - down_ratio) / (up_ratio - down_ratio);
+  }
+
+ private:
+  struct Inputs {
+    BinomialTree::Version tree;
+    uint64_t curve;
+    std::optional<uint64_t> foreign_curve;
+
+    bool operator==(const Inputs&) const = default;
+  };
+
+  // Checks the up-probabilities out of the active nodes of every populated
+  // timeslice, a timeslice at a time. Those of an implicit lattice are the
+  // same across a timeslice, so only one node per timeslice is checked.
+  bool checkUpProbs(const BinomialTree& tree) {
+    if (states_.size() < tree.numTimesteps() + 1) {
+      states_.resize(tree.numTimesteps() + 1);
+      next_states_.resize(tree.numTimesteps() + 1);
+    }
+    // The final timeslice of a forward-propagated tree is left empty.
+    for (int t = 0; t + 1 < tree.numTimesteps(); ++t) {
+      NodeRange nodes = tree.activeNodes(t);
+      if (tree.isImplicitLattice()) {
+        nodes.last = nodes.first;
+      }
+      const int n = nodes.size();
+      tree.copyTimeslice(t, nodes, states_.head(n));
+      tree.copyTimeslice(t + 1,
+                         NodeRange{nodes.first, nodes.last + 1},
+                         next_states_.head(n + 1));
+      const auto p = upProbs(t, states_.head(n), next_states_.head(n + 1));
+      if ((p <= 0.0 || p >= 1.0).any()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::optional<Inputs> inputs_;
+  int num_updates_ = 0;
+  bool arbitrage_free_ = true;
+
+  // Scratch timeslices for checkUpProbs.
+  Eigen::ArrayXd states_;
+  Eigen::ArrayXd next_states_;
+
+  std::vector<double> fwd_dfs_;
+  std::vector<double> growth_factors_;
+
+  // Products of the above from time index 0 up to each time index.
+  std::vector<double> cumulative_dfs_;
+  std::vector<double> cumulative_growth_;
+};
+
+}  // namespace smileexplorer
+
+#endif  // SMILEEXPLORER_TREES_BINOMIAL_TRANSITION_TABLE_H_
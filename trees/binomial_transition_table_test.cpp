@@ -0,0 +1,101 @@
+#include "trees/binomial_transition_table.h"
+
+#include <gtest/gtest.h>
+
+#include "rates/zero_curve.h"
+#include "trees/propagators.h"
+#include "trees/stochastic_tree_model.h"
+#include "volatility/volatility.h"
+
+namespace smileexplorer {
+namespace {
+
+struct SkewedVol {
+  static constexpr VolSurfaceFnType type =
+      VolSurfaceFnType::kTimeInvariantSkewSmile;
+  double operator()(double s) const {
+    return std::max(0.2 - 0.5 * (s - 100) / 100, 0.05);
+  }
+};
+
+TEST(BinomialTransitionTableTest, MatchesTreeUpProbabilities) {
+  ZeroSpotCurve curve({1.0, 5.0}, {0.03, 0.05});
+  ZeroSpotCurve foreign_curve({1.0, 5.0}, {0.01, 0.02});
+
+  StochasticTreeModel crr_asset(BinomialTree(2.0, 1 / 12.),
+                                CRRPropagator(100));
+  crr_asset.forwardPropagate(Volatility(FlatVol(0.15)));
+
+  StochasticTreeModel lv_asset(BinomialTree(2.0, 1 / 12.),
+                               LocalVolatilityPropagator(curve, 100));
+  lv_asset.forwardPropagate(Volatility(SkewedVol()));
+
+  for (const BinomialTree* tree :
+       {&crr_asset.binomialTree(), &lv_asset.binomialTree()}) {
+    BinomialTransitionTable table;
+    table.update(*tree, curve);
+    BinomialTransitionTable fx_table;
+    fx_table.update(*tree, curve, &foreign_curve);
+
+    const auto& timegrid = tree->getTimegrid();
+    for (int t = 0; t < tree->numTimesteps() - 1; ++t) {
+      EXPECT_DOUBLE_EQ(curve.forwardDF(timegrid.time(t), timegrid.time(t + 1)),
+                       table.forwardDF(t));
+      for (int i = 0; i <= t; ++i) {
+        EXPECT_DOUBLE_EQ(tree->getUpProbAt(curve, t, i),
+                         table.upProb(*tree, t, i));
+        EXPECT_DOUBLE_EQ(tree->getUpProbAt(curve, foreign_curve, t, i),
+                         fx_table.upProb(*tree, t, i));
+      }
+    }
+  }
+}
+
+TEST(BinomialTransitionTableTest, OnlyUpdatesOnceTheInputsChange) {
+  ZeroSpotCurve curve({1.0, 5.0}, {0.03, 0.05});
+  ZeroSpotCurve foreign_curve({1.0, 5.0}, {0.01, 0.02});
+  StochasticTreeModel asset(BinomialTree(2.0, 1 / 12.), CRRPropagator(100));
+  asset.forwardPropagate(Volatility(FlatVol(0.15)));
+
+  BinomialTransitionTable table;
+  table.update(asset.binomialTree(), curve);
+  table.update(asset.binomialTree(), curve);
+  EXPECT_EQ(1, table.numUpdates());
+
+  curve.updateRateAtMaturityIndex(0, 0.04);
+  table.update(asset.binomialTree(), curve);
+  EXPECT_EQ(2, table.numUpdates());
+  EXPECT_DOUBLE_EQ(curve.forwardDF(0, 1 / 12.), table.forwardDF(0));
+
+  table.update(asset.binomialTree(), curve, &foreign_curve);
+  EXPECT_EQ(3, table.numUpdates());
+
+  asset.forwardPropagate(Volatility(FlatVol(0.25)));
+  table.update(asset.binomialTree(), curve, &foreign_curve);
+  EXPECT_EQ(4, table.numUpdates());
+}
+
+TEST(BinomialTransitionTableTest, ChecksTheNoArbitrageCondition) {
+  ZeroSpotCurve curve({1.0, 5.0}, {0.03, 0.05});
+
+  StochasticTreeModel asset(BinomialTree(2.0, 1 / 12.), CRRPropagator(100));
+  asset.forwardPropagate(Volatility(FlatVol(0.15)));
+  BinomialTransitionTable table;
+  table.update(asset.binomialTree(), curve);
+  EXPECT_TRUE(table.isArbitrageFree());
+
+  // The up move of a CRR tree falls short of the growth at the risk-free rate
+  // once the vol is below r * sqrt(dt).
+  asset.forwardPropagate(Volatility(FlatVol(0.005)));
+  table.update(asset.binomialTree(), curve);
+  EXPECT_FALSE(table.isArbitrageFree());
+
+  StochasticTreeModel lv_asset(BinomialTree(2.0, 1 / 12.),
+                               LocalVolatilityPropagator(curve, 100));
+  lv_asset.forwardPropagate(Volatility(SkewedVol()));
+  table.update(lv_asset.binomialTree(), curve);
+  EXPECT_TRUE(table.isArbitrageFree());
+}
+
+}  // namespace
+}  // namespace smileexplorer
@@ -2,9 +2,15 @@
 #define SMILEEXPLORER_TREES_BINOMIAL_TREE_H_
 
 #include <Eigen/Dense>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <optional>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "rates/rates_curve.h"
@@ -13,6 +19,20 @@
 
 namespace smileexplorer {
 
+// A contiguous range [first, last] of node indices within a timeslice.
+struct NodeRange {
+  int first;
+  int last;
+
+  int size() const { return last - first + 1; }
+  bool contains(int i) const { return i >= first && i <= last; }
+};
+
+// Precision in which the nodes of an explicitly stored tree are kept. Either
+// way, node values are read and written as doubles, so single precision only
+// rounds what is stored (to about 6e-8 relative error) and halves the memory.
+enum class StoragePrecision { kDouble, kSingle };
+
 class BinomialTree {
  public:
   BinomialTree(double total_duration_years, double timestep_years)
@@ -24,8 +44,7 @@ class BinomialTree {
       timestep_years_ = tree_duration_years_ * 0.5;
     }
     int num_timesteps = std::ceil(tree_duration_years_ / timestep_years_) + 1;
-    tree_.resize(num_timesteps, num_timesteps);
-    tree_.setZero();
+    resizeAndZero(num_timesteps);
   }
 
   BinomialTree() {}
@@ -44,45 +63,139 @@ class BinomialTree {
                         timestep.count() / numDaysInYear(style));
   }
 
+  // Returns an explicitly stored tree with the same shape and timegrid as
+  // `underlying`, with all nodes set to zero.
   static BinomialTree createFrom(const BinomialTree& underlying) {
-    BinomialTree derived = underlying;
-    derived.tree_.setZero();
+    BinomialTree derived;
+    derived.reshapeLike(underlying);
+    derived.resizeAndZero(underlying.num_timeslices_);
     return derived;
   }
 
+  // Makes this an explicitly stored tree with the same shape, timegrid,
+  // truncation band and storage precision as `underlying`, without copying
+  // its node values. If the number of stored nodes is unchanged, the storage
+  // is reused and the node values are left as they are; otherwise they are
+  // all set to zero.
+  void reshapeLike(const BinomialTree& underlying) {
+    markModified();
+    tree_duration_years_ = underlying.tree_duration_years_;
+    timestep_years_ = underlying.timestep_years_;
+    truncation_std_devs_ = underlying.truncation_std_devs_;
+    truncation_vol_ = underlying.truncation_vol_;
+    truncation_log_growth_ = underlying.truncation_log_growth_;
+    active_nodes_ = underlying.active_nodes_;
+    stored_nodes_ = underlying.stored_nodes_;
+    stored_offsets_ = underlying.stored_offsets_;
+    timegrid_ = underlying.timegrid_;
+    time_factors_.resize(0);
+    path_factors_.resize(0);
+    lattice_spot_ = 1.0;
+    num_timeslices_ = underlying.num_timeslices_;
+    if (precision_ != underlying.precision_) {
+      setStoragePrecision(underlying.precision_);
+    }
+    if (storedSize() != timesliceOffset(num_timeslices_)) {
+      zeroStorage();
+    }
+  }
+
+  // Converts the stored nodes (if any) to `precision`. Implicit lattices
+  // store no nodes, so this only affects trees which are explicitly
+  // populated afterwards, such as derivative trees created from them.
+  void setStoragePrecision(StoragePrecision precision) {
+    if (precision == precision_) {
+      return;
+    }
+    markModified();
+    if (precision == StoragePrecision::kSingle) {
+      single_tree_ = tree_.cast<float>();
+      tree_.resize(0);
+    } else {
+      tree_ = single_tree_.cast<double>();
+      single_tree_.resize(0);
+    }
+    precision_ = precision;
+  }
+
+  StoragePrecision storagePrecision() const { return precision_; }
+
+  // The number of node values held in memory: one per node of an explicitly
+  // stored tree (or, if it is truncated, per materialized node), and none for
+  // an implicit lattice.
+  Eigen::Index numStoredNodes() const { return storedSize(); }
+
+  // Identifies the contents of the tree (its nodes, timegrid and truncation
+  // band). Every change to the tree changes its version, and no two trees
+  // (not even copies) share a version, so that results derived from a tree
+  // can be cached.
+  struct Version {
+    uint64_t generation;
+    uint64_t num_writes;
+
+    bool operator==(const Version&) const = default;
+  };
+  Version version() const { return {generation_.value, num_writes_}; }
+
   int numTimesteps() const {
     // Subtract 1, because the number of timesteps represents the number of
     // differences (dt's)
-    return tree_.rows() - 1;
+    return num_timeslices_ - 1;
   }
 
   double sumAtTimestep(int time_index) const {
-    return tree_.row(time_index).sum();
+    return timesliceValues(time_index).sum();
   }
 
   void printAtTime(int time_index) const {
     std::cout << "Time " << time_index << ": ";
-    std::cout << tree_.row(time_index) << std::endl;
+    std::cout << timesliceValues(time_index).transpose() << std::endl;
   }
   void printUpTo(int time_index) const {
     for (int i = 0; i < time_index; ++i) {
-      std::cout << "t:" << i << " ::  " << tree_.row(i).head(i + 1)
+      std::cout << "t:" << i << " ::  " << timesliceValues(i).transpose()
                 << std::endl;
     }
   }
 
   void setZeroAfterIndex(int time_index) {
-    for (int i = time_index + 1; i < tree_.rows(); ++i) {
-      tree_.row(i).setZero();
+    if (time_index + 1 >= num_timeslices_) {
+      return;
     }
+    markModified();
+    // Timeslices are stored contiguously, so everything after `time_index` is
+    // a single tail segment.
+    withMutableStorage([&](auto& tree) {
+      tree.tail(tree.size() - timesliceOffset(time_index + 1)).setZero();
+    });
   }
 
+  // Nodes outside the band of a truncated tree are not stored, and are zero.
   double nodeValue(int time_index, int node_index) const {
-    return tree_(time_index, node_index);
+    if (isImplicitLattice()) {
+      return lattice_spot_ * time_factors_[time_index] *
+             path_factors_[time_index - node_index];
+    }
+    if (!isStored(time_index, node_index)) {
+      return 0.0;
+    }
+    if (precision_ == StoragePrecision::kSingle) {
+      return single_tree_[nodeOffset(time_index, node_index)];
+    }
+    return tree_[nodeOffset(time_index, node_index)];
+  }
+
+  // The value which nodeValue returns after setValue(..., value), i.e.
+  // `value` rounded to the storage precision.
+  double roundToStorage(double value) const {
+    if (precision_ == StoragePrecision::kSingle) {
+      return static_cast<float>(value);
+    }
+    return value;
   }
 
   std::optional<double> safeNodeValue(int time_index, int node_index) const {
-    if (time_index < 0 || time_index >= tree_.rows() || node_index < 0 ||
+    if (time_index < 0 || time_index >= num_timeslices_ || node_index < 0 ||
         node_index > time_index) {
       return std::nullopt;
     }
@@ -92,7 +205,70 @@ class BinomialTree {
   bool isTreeEmptyAt(int time_index) const {
     // current assumption: if an entire row is 0, nothing after it can be
     // populated.
-    return tree_.row(time_index).isZero(0);
+    if (isImplicitLattice()) {
+      return time_factors_[time_index] == 0;
+    }
+    return withStorage([&](const auto& tree) {
+      return tree
+          .segment(timesliceOffset(time_index),
+                   materializedNodes(time_index).size())
+          .isZero(0);
+    });
+  }
+
+  // Writes the time_index + 1 states at `time_index` into the Eigen array
+  // (or array block) `out`, whichever way the tree is stored.
+  template <typename ArrayT>
+  void copyTimeslice(int time_index, ArrayT&& out) const {
+    if (isImplicitLattice()) {
+      out = lattice_spot_ * time_factors_[time_index] *
+            path_factors_.head(time_index + 1).reverse().array();
+    } else {
+      copyTimeslice(time_index, NodeRange{0, time_index}, out);
+    }
+  }
+
+  // Writes the states at the `nodes` of `time_index` into `out`. Nodes which
+  // are not stored (see materializedNodes) come out as zero.
+  template <typename ArrayT>
+  void copyTimeslice(int time_index, NodeRange nodes, ArrayT&& out) const {
+    if (isImplicitLattice()) {
+      out = lattice_spot_ * time_factors_[time_index] *
+            path_factors_.segment(time_index - nodes.last, nodes.size())
+                .reverse()
+                .array();
+      return;
+    }
+    const NodeRange stored = materializedNodes(time_index);
+    const NodeRange copied{std::max(nodes.first, stored.first),
+                           std::min(nodes.last, stored.last)};
+    if (copied.first != nodes.first || copied.last != nodes.last) {
+      out.setZero();
+    }
+    if (copied.size() <= 0) {
+      return;
+    }
+    withStorage([&](const auto& tree) {
+      out.segment(copied.first - nodes.first, copied.size()) =
+          tree.segment(nodeOffset(time_index, copied.first), copied.size())
+              .array()
+              .template cast<double>();
+    });
+  }
+
+  // Writes `values` into the `nodes` of `time_index`, rounding them to the
+  // storage precision. Only available for explicitly stored trees, and only
+  // for stored nodes.
+  template <typename ValuesT>
+  void setTimeslice(int time_index,
+                    NodeRange nodes,
+                    const Eigen::ArrayBase<ValuesT>& values) {
+    ++num_writes_;
+    withMutableStorage([&](auto& tree) {
+      using Scalar = typename std::decay_t<decltype(tree)>::Scalar;
+      tree.segment(nodeOffset(time_index, nodes.first), nodes.size()) =
+          values.template cast<Scalar>().matrix();
+    });
   }
 
   const Timegrid& getTimegrid() const { return timegrid_; }
@@ -104,16 +280,113 @@ class BinomialTree {
   double timestepAt(int time_index) const { return timegrid_.dt(time_index); }
   double treeDurationYears() const { return tree_duration_years_; }
 
+  // Writes to nodes outside the band of a truncated tree are dropped, since
+  // these nodes are not stored.
   void setValue(int time_index, int node_index, double val) {
-    tree_(time_index, node_index) = val;
+    if (!isStored(time_index, node_index)) {
+      return;
+    }
+    ++num_writes_;
+    if (precision_ == StoragePrecision::kSingle) {
+      single_tree_[nodeOffset(time_index, node_index)] = val;
+      return;
+    }
+    tree_[nodeOffset(time_index, node_index)] = val;
+  }
+
+  // In an implicit lattice, no node values are stored. Instead, node (t, i)
+  // is spot * time_factors[t] * path_factors[t - i], which is exact for trees
+  // whose up and down moves depend on the time index only (e.g. CRR and
+  // Jarrow-Rudd without a smile). This takes O(N) rather than O(N^2) memory.
+  // Each vector needs one entry per timeslice of `timegrid`, and the factors
+  // are normalized to a unit spot (time_factors[0] == path_factors[0] == 1).
+  // Nodes cannot be modified with setValue afterwards.
+  void setImplicitLattice(Timegrid timegrid,
+                          Eigen::VectorXd time_factors,
+                          Eigen::VectorXd path_factors,
+                          double spot) {
+    markModified();
+    timegrid_ = std::move(timegrid);
+    num_timeslices_ = timegrid_.size();
+    updateBands();
+    tree_.resize(0);
+    single_tree_.resize(0);
+    time_factors_ = std::move(time_factors);
+    path_factors_ = std::move(path_factors);
+    lattice_spot_ = spot;
+  }
+
+  // Every node of an implicit lattice is proportional to the spot, so moving
+  // the spot only rescales the tree, without any forward propagation.
+  void setLatticeSpot(double spot) {
+    markModified();
+    lattice_spot_ = spot;
+  }
+
+  bool isImplicitLattice() const { return time_factors_.size() > 0; }
+
+  // Restricts the tree to a band of nodes within `num_std_devs` (at least 1)
+  // standard deviations of its spine. The number of up moves into time index
+  // t has a standard deviation of about sqrt(t) / 2 nodes, so the band holds
+  // O(N^1.5) nodes rather than O(N^2). Only nodes within the band are
+  // forward-propagated and backward-inducted, with one extra node on each
+  // side to hold boundary values, and only these are stored: each timeslice
+  // keeps a contiguous run of nodes, so memory is O(N^1.5) as well. Every
+  // other node reads as zero. Truncation resets the nodes of an explicitly
+  // stored tree, so truncate it before forward propagation.
+  void truncate(double num_std_devs) {
+    setTruncation(num_std_devs, Eigen::VectorXd(), 0.0);
+  }
+
+  // As above, but with the band centred on the forward of the asset under
+  // `curve` (divided by the growth under `foreign_curve`, for currencies),
+  // which drifts away from the spine. Node (t, i) is taken to lie
+  // 2 * (i - t / 2) * vol * sqrt(dt) from the spot in log space, as in CRR
+  // trees (and local vol trees, with the ATM vol). The curves are only read
+  // here, at multiples of the timestep.
+  void truncate(double num_std_devs,
+                const RatesCurve& curve,
+                double vol,
+                const RatesCurve* foreign_curve = nullptr) {
+    const int num_samples = std::max(num_timeslices_, 1) + 1;
+    Eigen::VectorXd log_growth(num_samples);
+    for (int k = 0; k < num_samples; ++k) {
+      const double time = k * timestep_years_;
+      log_growth[k] = -std::log(curve.df(time));
+      if (foreign_curve != nullptr) {
+        log_growth[k] += std::log(foreign_curve->df(time));
+      }
+    }
+    setTruncation(num_std_devs, std::move(log_growth), vol);
+  }
+
+  bool isTruncated() const { return truncation_std_devs_.has_value(); }
+
+  // The nodes at `time_index` within the truncation band (i.e. all of them if
+  // the tree is not truncated).
+  NodeRange activeNodes(int time_index) const {
+    if (!isTruncated()) {
+      return {0, time_index};
+    }
+    return active_nodes_[time_index];
+  }
+
+  // The active nodes, plus the boundary node on either side of them (if
+  // any). These are the only nodes with values in a truncated tree.
+  NodeRange materializedNodes(int time_index) const {
+    if (!isTruncated()) {
+      return {0, time_index};
+    }
+    return stored_nodes_[time_index];
   }
 
   // TODO make this not take a vol, that makes it brittle.
   template <typename VolSurfaceT>
   void resizeWithTimeDependentVol(const Volatility<VolSurfaceT>& volfn) {
     timegrid_ = volfn.generateTimegrid(tree_duration_years_, timestep_years_);
-    tree_.resize(timegrid_.size(), timegrid_.size());
-    tree_.setZero();
+    time_factors_.resize(0);
+    path_factors_.resize(0);
+    resizeAndZero(timegrid_.size());
   }
 
   double getUpProbAt(const RatesCurve& curve, int time_index, int i) const;
@@ -132,20 +405,205 @@ class BinomialTree {
   }
 
   std::vector<double> statesAtTimeIndex(int ti) const {
-    if (ti >= tree_.rows()) {
-      ti = tree_.rows() - 1;
+    if (ti >= num_timeslices_) {
+      ti = num_timeslices_ - 1;
     }
-    const auto row = tree_.row(ti);
-    return std::vector<double>(row.begin(), row.begin() + ti + 1);
+    const auto row = timesliceValues(ti);
+    return std::vector<double>(row.begin(), row.end());
   }
 
  private:
-  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic> tree_;
+  // Packed, row-major lower-triangular storage: timeslice t holds t + 1 nodes
+  // and starts at offset t * (t + 1) / 2, so each timeslice is contiguous and
+  // no storage is spent on the unused upper triangle. A truncated tree only
+  // stores the materialized nodes of each timeslice (see stored_offsets_).
+  // Only one of these is populated, depending on precision_.
+  Eigen::VectorXd tree_;
+  Eigen::VectorXf single_tree_;
+  StoragePrecision precision_ = StoragePrecision::kDouble;
+  int num_timeslices_ = 0;
+
+  // Only populated for an implicit lattice (in which case tree_ is empty).
+  Eigen::VectorXd time_factors_;
+  Eigen::VectorXd path_factors_;
+  double lattice_spot_ = 1.0;
+
+  std::optional<double> truncation_std_devs_;
+
+  // The log of the forward growth of the asset at multiples of the timestep,
+  // and the vol which spaces the nodes. Empty for a band centred on the spine.
+  Eigen::VectorXd truncation_log_growth_;
+  double truncation_vol_ = 0.0;
+
+  // Only populated for a truncated tree: the active and materialized nodes of
+  // each timeslice, and the offset at which the materialized nodes of each
+  // timeslice are stored (plus, at the end, the number of stored nodes).
+  std::vector<NodeRange> active_nodes_;
+  std::vector<NodeRange> stored_nodes_;
+  std::vector<Eigen::Index> stored_offsets_;
+
   double tree_duration_years_;
   double timestep_years_;
 
   Timegrid timegrid_;
 
+  // Part of the version. Renewed by every change to the tree, other than
+  // writes to nodes (which are only counted, in num_writes_, so that they
+  // stay cheap), and by copying the tree.
+  struct Generation {
+    Generation() = default;
+    Generation(const Generation&) {}
+    Generation& operator=(const Generation&) {
+      value = next();
+      return *this;
+    }
+
+    static uint64_t next() {
+      static std::atomic<uint64_t> next_generation = 1;
+      return next_generation++;
+    }
+
+    uint64_t value = next();
+  };
+  Generation generation_;
+  uint64_t num_writes_ = 0;
+
+  void markModified() { generation_.value = Generation::next(); }
+
+  // Calls `fn` with whichever of tree_ and single_tree_ holds the nodes.
+  template <typename FnT>
+  std::invoke_result_t<FnT, Eigen::VectorXd&> withMutableStorage(FnT&& fn) {
+    return precision_ == StoragePrecision::kSingle ? fn(single_tree_)
+                                                   : fn(tree_);
+  }
+  template <typename FnT>
+  std::invoke_result_t<FnT, const Eigen::VectorXd&> withStorage(
+      FnT&& fn) const {
+    return precision_ == StoragePrecision::kSingle ? fn(single_tree_)
+                                                   : fn(tree_);
+  }
+
+  Eigen::Index storedSize() const {
+    return withStorage([](const auto& tree) { return tree.size(); });
+  }
+
+  // The offset of the first stored node at `time_index`. Without truncation,
+  // timeslice t holds t + 1 nodes and starts at t * (t + 1) / 2.
+  Eigen::Index timesliceOffset(int time_index) const {
+    if (isTruncated()) {
+      return stored_offsets_[time_index];
+    }
+    return static_cast<Eigen::Index>(time_index) * (time_index + 1) / 2;
+  }
+
+  bool isStored(int time_index, int node_index) const {
+    return !isTruncated() || stored_nodes_[time_index].contains(node_index);
+  }
+
+  // The offset of node (t, i), which must be stored.
+  Eigen::Index nodeOffset(int time_index, int node_index) const {
+    return timesliceOffset(time_index) + node_index -
+           materializedNodes(time_index).first;
+  }
+
+  Eigen::ArrayXd timesliceValues(int time_index) const {
+    Eigen::ArrayXd values(time_index + 1);
+    copyTimeslice(time_index, values);
+    return values;
+  }
+
+  void resizeAndZero(int num_timeslices) {
+    markModified();
+    num_timeslices_ = num_timeslices;
+    updateBands();
+    zeroStorage();
+  }
+
+  void zeroStorage() {
+    withMutableStorage(
+        [&](auto& tree) { tree.setZero(timesliceOffset(num_timeslices_)); });
+  }
+
+  void setTruncation(double num_std_devs,
+                     Eigen::VectorXd log_growth,
+                     double vol) {
+    truncation_std_devs_ = std::max(num_std_devs, 1.0);
+    truncation_log_growth_ = std::move(log_growth);
+    truncation_vol_ = vol;
+    if (isImplicitLattice()) {
+      markModified();
+      updateBands();
+    } else {
+      resizeAndZero(num_timeslices_);
+    }
+  }
+
+  // The distance in nodes from the spine at `time_index` to the forward, if
+  // the band is centred on it. Before the timegrid is in place (i.e. before
+  // forward propagation), the timestep is taken to be uniform.
+  double forwardNodeOffset(int time_index) const {
+    if (truncation_log_growth_.size() == 0 || time_index == 0) {
+      return 0.0;
+    }
+    double time = time_index * timestep_years_;
+    double dt = timestep_years_;
+    if (timegrid_.size() >= num_timeslices_) {
+      time = timegrid_.time(time_index);
+      dt = time - timegrid_.time(time_index - 1);
+    }
+    const int last = truncation_log_growth_.size() - 1;
+    const double x =
+        std::clamp(time / timestep_years_, 0.0, static_cast<double>(last));
+    const int k = std::min(static_cast<int>(x), last - 1);
+    const double log_growth =
+        truncation_log_growth_[k] +
+        (x - k) * (truncation_log_growth_[k + 1] - truncation_log_growth_[k]);
+    return log_growth / (2 * truncation_vol_ * std::sqrt(dt));
+  }
+
+  // Lays out the band of each timeslice of a truncated tree.
+  void updateBands() {
+    active_nodes_.clear();
+    stored_nodes_.clear();
+    stored_offsets_.clear();
+    if (!isTruncated()) {
+      return;
+    }
+    active_nodes_.reserve(num_timeslices_);
+    stored_nodes_.reserve(num_timeslices_);
+    stored_offsets_.reserve(num_timeslices_ + 1);
+    stored_offsets_.push_back(0);
+    NodeRange prev{0, 0};
+    for (int t = 0; t < num_timeslices_; ++t) {
+      NodeRange active{0, 0};
+      if (t > 0) {
+        const double centre = 0.5 * t + forwardNodeOffset(t);
+        const double half_width =
+            0.5 * truncation_std_devs_.value() * std::sqrt(t);
+        // Like the tree itself, the band moves up by at most one node per
+        // timestep, and it always keeps the spine (from which explicit trees
+        // are propagated). This way, the nodes of each timeslice are
+        // propagated from, and rolled back into, materialized nodes only.
+        active.first =
+            std::clamp(static_cast<int>(std::ceil(centre - half_width)),
+                       prev.first,
+                       prev.first + 1);
+        active.last =
+            std::clamp(static_cast<int>(std::floor(centre + half_width)),
+                       prev.last,
+                       prev.last + 1);
+        active.last = std::max(active.last, t / 2);
+        active.first = std::min({active.first, (t + 1) / 2, active.last});
+      }
+      const NodeRange stored{std::max(0, active.first - 1),
+                             std::min(t, active.last + 1)};
+      active_nodes_.push_back(active);
+      stored_nodes_.push_back(stored);
+      stored_offsets_.push_back(stored_offsets_.back() + stored.size());
+      prev = active;
+    }
+  }
+
   // Internal method to facilitate factoring out of common functionality,
   // whether there is only one discount curve or two (in the case of currency
   // derivs).
@@ -2,6 +2,174 @@
 
 #include <gtest/gtest.h>
 
+#include <cmath>
+
 namespace smileexplorer {
-namespace {}  // namespace
+namespace {
+
+BinomialTree createTreeWithNodeIds(int num_timesteps) {
+  BinomialTree tree(num_timesteps, 1.0);
+  for (int t = 0; t <= tree.numTimesteps(); ++t) {
+    for (int i = 0; i <= t; ++i) {
+      tree.setValue(t, i, 100 * t + i);
+    }
+  }
+  return tree;
+}
+
+TEST(BinomialTreeTest, PackedTimeslicesDoNotOverlap) {
+  const auto tree = createTreeWithNodeIds(5);
+  EXPECT_EQ(5, tree.numTimesteps());
+
+  for (int t = 0; t <= tree.numTimesteps(); ++t) {
+    Eigen::ArrayXd timeslice(t + 1);
+    tree.copyTimeslice(t, timeslice);
+    for (int i = 0; i <= t; ++i) {
+      EXPECT_EQ(100 * t + i, tree.nodeValue(t, i));
+      EXPECT_EQ(100 * t + i, timeslice[i]);
+    }
+  }
+  EXPECT_EQ(300 + 301 + 302 + 303, tree.sumAtTimestep(3));
+  EXPECT_EQ(std::vector<double>({200, 201, 202}), tree.statesAtTimeIndex(2));
+}
+
+TEST(BinomialTreeTest, SafeNodeValueRejectsUpperTriangle) {
+  const auto tree = createTreeWithNodeIds(3);
+  EXPECT_EQ(201, tree.safeNodeValue(2, 1));
+  EXPECT_EQ(std::nullopt, tree.safeNodeValue(2, 3));
+  EXPECT_EQ(std::nullopt, tree.safeNodeValue(-1, 0));
+  EXPECT_EQ(std::nullopt, tree.safeNodeValue(4, 0));
+}
+
+TEST(BinomialTreeTest, SetZeroAfterIndex) {
+  auto tree = createTreeWithNodeIds(4);
+  tree.setZeroAfterIndex(2);
+  EXPECT_FALSE(tree.isTreeEmptyAt(2));
+  EXPECT_TRUE(tree.isTreeEmptyAt(3));
+  EXPECT_TRUE(tree.isTreeEmptyAt(4));
+  EXPECT_EQ(202, tree.nodeValue(2, 2));
+
+  // Zeroing after the final timeslice is a no-op.
+  tree.setZeroAfterIndex(tree.numTimesteps());
+  EXPECT_EQ(202, tree.nodeValue(2, 2));
+}
+
+TEST(BinomialTreeTest, CreateFromCopiesShapeOnly) {
+  const auto tree = createTreeWithNodeIds(4);
+  const auto derived = BinomialTree::createFrom(tree);
+  EXPECT_EQ(tree.numTimesteps(), derived.numTimesteps());
+  for (int t = 0; t <= derived.numTimesteps(); ++t) {
+    EXPECT_TRUE(derived.isTreeEmptyAt(t));
+  }
+}
+
+TEST(BinomialTreeTest, SinglePrecisionStorage) {
+  auto tree = createTreeWithNodeIds(4);
+  tree.setStoragePrecision(StoragePrecision::kSingle);
+  EXPECT_EQ(StoragePrecision::kSingle, tree.storagePrecision());
+  EXPECT_EQ(302, tree.nodeValue(3, 2));
+  EXPECT_EQ(std::vector<double>({200, 201, 202}), tree.statesAtTimeIndex(2));
+
+  // Values are rounded to float when stored.
+  tree.setValue(1, 0, 0.1);
+  EXPECT_EQ(0.1f, tree.nodeValue(1, 0));
+  tree.setTimeslice(2, {1, 2}, Eigen::Array2d(1 / 3., 2 / 3.));
+  EXPECT_EQ(std::vector<double>({200, 1 / 3.f, 2 / 3.f}),
+            tree.statesAtTimeIndex(2));
+
+  tree.setZeroAfterIndex(2);
+  EXPECT_FALSE(tree.isTreeEmptyAt(2));
+  EXPECT_TRUE(tree.isTreeEmptyAt(3));
+
+  // Derived trees take on the precision, and converting back keeps the
+  // (rounded) values.
+  const auto derived = BinomialTree::createFrom(tree);
+  EXPECT_EQ(StoragePrecision::kSingle, derived.storagePrecision());
+  tree.setStoragePrecision(StoragePrecision::kDouble);
+  EXPECT_EQ(0.1f, tree.nodeValue(1, 0));
+  EXPECT_EQ(1 / 3.f, tree.nodeValue(2, 1));
+}
+
+TEST(BinomialTreeTest, TruncationBand) {
+  BinomialTree tree(10.0, 1 / 365.);
+  EXPECT_FALSE(tree.isTruncated());
+  EXPECT_EQ(0, tree.activeNodes(100).first);
+  EXPECT_EQ(100, tree.activeNodes(100).last);
+
+  tree.truncate(7);
+  EXPECT_TRUE(tree.isTruncated());
+  long num_active_nodes = 0;
+  for (int t = 0; t <= tree.numTimesteps(); ++t) {
+    const NodeRange active = tree.activeNodes(t);
+    const NodeRange stored = tree.materializedNodes(t);
+    num_active_nodes += active.size();
+
+    // The band is centred on the spine, and covers every node near the root.
+    EXPECT_TRUE(active.contains(t / 2));
+    EXPECT_TRUE(active.contains((t + 1) / 2));
+    if (t <= 49) {
+      EXPECT_EQ(t + 1, active.size());
+    }
+    EXPECT_LE(stored.first, active.first);
+    EXPECT_GE(stored.last, active.last);
+    EXPECT_LE(stored.size(), active.size() + 2);
+
+    // Backward induction out of the active nodes only needs materialized
+    // nodes, and so does forward propagation into the materialized nodes.
+    if (t > 0) {
+      const NodeRange prev_active = tree.activeNodes(t - 1);
+      const NodeRange prev_stored = tree.materializedNodes(t - 1);
+      EXPECT_TRUE(stored.contains(prev_active.first));
+      EXPECT_TRUE(stored.contains(prev_active.last + 1));
+      EXPECT_LE(prev_stored.first, stored.first);
+      EXPECT_GE(prev_stored.last, stored.last - 1);
+    }
+  }
+
+  // About 7 * (2/3) * N^1.5 nodes, rather than N^2 / 2.
+  const long n = tree.numTimesteps();
+  EXPECT_LT(num_active_nodes, 5 * std::pow(n, 1.5));
+  EXPECT_LT(num_active_nodes, n * n / 10);
+
+  // Only the materialized nodes are stored: for this 3650-step tree, about
+  // 1.0M nodes out of 6.7M, i.e. a sixth of the memory (and work).
+  long num_stored_nodes = 0;
+  for (int t = 0; t <= tree.numTimesteps(); ++t) {
+    num_stored_nodes += tree.materializedNodes(t).size();
+  }
+  EXPECT_EQ(num_stored_nodes, tree.numStoredNodes());
+  const long num_nodes = (n + 1) * (n + 2) / 2;
+  EXPECT_EQ(num_nodes, BinomialTree(10.0, 1 / 365.).numStoredNodes());
+  EXPECT_LT(tree.numStoredNodes(), 0.16 * num_nodes);
+}
+
+TEST(BinomialTreeTest, TruncatedTreesOnlyStoreTheirBand) {
+  BinomialTree tree(100, 1.0);
+  tree.truncate(2);
+  for (int t = 0; t <= tree.numTimesteps(); ++t) {
+    for (int i = 0; i <= t; ++i) {
+      tree.setValue(t, i, 1000 * t + i);
+    }
+  }
+
+  // Writes outside the band are dropped, and every node outside it is zero.
+  for (int t = 0; t <= tree.numTimesteps(); ++t) {
+    const NodeRange stored = tree.materializedNodes(t);
+    for (int i = 0; i <= t; ++i) {
+      EXPECT_EQ(stored.contains(i) ? 1000 * t + i : 0, tree.nodeValue(t, i));
+    }
+    const auto states = tree.statesAtTimeIndex(t);
+    EXPECT_EQ(t + 1, std::ssize(states));
+    EXPECT_EQ(tree.sumAtTimestep(t),
+              (stored.first + stored.last) * stored.size() / 2.0 +
+                  1000. * t * stored.size());
+  }
+
+  // Derived trees share the layout.
+  const auto derived = BinomialTree::createFrom(tree);
+  EXPECT_EQ(tree.numStoredNodes(), derived.numStoredNodes());
+  EXPECT_TRUE(derived.isTreeEmptyAt(tree.numTimesteps()));
+}
+
+}  // namespace
 }  // namespace smileexplorer
@@ -0,0 +1,95 @@
+#ifndef SMILEEXPLORER_TREES_FIXED_BINOMIAL_TREE_H_
+#define SMILEEXPLORER_TREES_FIXED_BINOMIAL_TREE_H_
+
+#include <Eigen/Dense>
+#include <array>
+#include <cmath>
+
+#include "time/timegrid.h"
+
+namespace smileexplorer {
+
+// A binomial tree with a compile-time number of timesteps N over a uniform
+// timegrid, for very short-dated options priced on small (e.g. 16 to 64
+// step) trees. The nodes are held in a packed std::array (in the same layout
+// as BinomialTree), so the tree has no heap storage and, for such sizes, fits
+// in L1 cache. Unlike BinomialTree, the final timeslice (at index N) is
+// populated, so that options expiring at the end of the tree can be priced.
+template <int N>
+class FixedBinomialTree {
+ public:
+  static_assert(N > 0, "A tree needs at least one timestep.");
+
+  static constexpr int kNumTimesteps = N;
+  static constexpr int kNumNodes = (N + 1) * (N + 2) / 2;
+
+  explicit FixedBinomialTree(double duration_years)
+      : timestep_years_(duration_years / N) {}
+
+  // Populates the tree with a propagator whose moves depend only on time,
+  // i.e. which provides latticeStep (such as CRRPropagator and
+  // JarrowRuddPropagator), from its spot. As with the implicit lattices of
+  // StochasticTreeModel, node (t, i) is
+  //   S_0 * exp(D_t + U_t) * exp(-2 * U_{t-i})
+  // for the cumulative drift D_t and diffusion U_t.
+  template <typename PropagatorT, typename VolatilityT>
+  void forwardPropagate(const PropagatorT& propagator,
+                        const VolatilityT& volatility) {
+    // latticeStep reads the timestep after each time index, hence the extra
+    // grid point.
+    Timegrid timegrid(N + 2);
+    for (int t = 0; t < N + 2; ++t) {
+      timegrid.set(t, time(t));
+    }
+
+    std::array<double, N + 1> time_factors;
+    std::array<double, N + 1> path_factors;
+    time_factors[0] = 1.0;
+    path_factors[0] = 1.0;
+    double cumulative_drift = 0.0;
+    double cumulative_diffusion = 0.0;
+    for (int t = 1; t <= N; ++t) {
+      const auto step = propagator.latticeStep(timegrid, volatility, t);
+      cumulative_drift += step.drift;
+      cumulative_diffusion += step.diffusion;
+      time_factors[t] = std::exp(cumulative_drift + cumulative_diffusion);
+      path_factors[t] = std::exp(-2 * cumulative_diffusion);
+    }
+
+    const double spot = propagator.spot();
+    for (int t = 0; t <= N; ++t) {
+      for (int i = 0; i <= t; ++i) {
+        nodes_[timesliceOffset(t) + i] =
+            spot * time_factors[t] * path_factors[t - i];
+      }
+    }
+  }
+
+  double nodeValue(int time_index, int node_index) const {
+    return nodes_[timesliceOffset(time_index) + node_index];
+  }
+
+  // The T + 1 states at time index T, as a fixed-size Eigen array.
+  template <int T>
+  auto timeslice() const {
+    static_assert(T >= 0 && T <= N);
+    return Eigen::Map<const Eigen::Array<double, T + 1, 1>>(
+        nodes_.data() + timesliceOffset(T));
+  }
+
+  double time(int time_index) const { return time_index * timestep_years_; }
+  double timestepYears() const { return timestep_years_; }
+  double durationYears() const { return N * timestep_years_; }
+
+  static constexpr int timesliceOffset(int time_index) {
+    return time_index * (time_index + 1) / 2;
+  }
+
+ private:
+  double timestep_years_;
+  std::array<double, kNumNodes> nodes_{};
+};
+
+}  // namespace smileexplorer
+
+#endif  // SMILEEXPLORER_TREES_FIXED_BINOMIAL_TREE_H_
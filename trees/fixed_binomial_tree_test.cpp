@@ -0,0 +1,50 @@
+#include "trees/fixed_binomial_tree.h"
+
+#include <gtest/gtest.h>
+
+#include <type_traits>
+
+#include "trees/propagators.h"
+#include "trees/stochastic_tree_model.h"
+#include "volatility/volatility.h"
+
+namespace smileexplorer {
+namespace {
+
+static_assert(std::is_trivially_copyable_v<FixedBinomialTree<32>>);
+
+template <int N, typename PropagatorT>
+void expectMatchesImplicitLattice(const PropagatorT& propagator) {
+  constexpr double kDuration = 1 / 52.;
+  constexpr double kTimestep = kDuration / N;
+  Volatility flat_vol(FlatVol(0.3));
+
+  FixedBinomialTree<N> tree(kDuration);
+  tree.forwardPropagate(propagator, flat_vol);
+
+  // The final timeslice of a BinomialTree is left empty, hence the extra
+  // timestep.
+  StochasticTreeModel asset(BinomialTree(kDuration + kTimestep, kTimestep),
+                            propagator);
+  asset.forwardPropagate(flat_vol);
+  const auto& lattice = asset.binomialTree();
+  ASSERT_EQ(N + 1, lattice.numTimesteps());
+
+  for (int t = 0; t <= N; ++t) {
+    EXPECT_NEAR(lattice.totalTimeAtIndex(t), tree.time(t), 1e-15);
+    for (int i = 0; i <= t; ++i) {
+      const double expected = lattice.nodeValue(t, i);
+      EXPECT_NEAR(expected, tree.nodeValue(t, i), expected * 1e-12);
+    }
+  }
+  EXPECT_EQ(tree.nodeValue(N, 3), tree.template timeslice<N>()[3]);
+}
+
+TEST(FixedBinomialTreeTest, MatchesImplicitLattice) {
+  expectMatchesImplicitLattice<16>(CRRPropagator(100));
+  expectMatchesImplicitLattice<64>(CRRPropagator(100));
+  expectMatchesImplicitLattice<32>(JarrowRuddPropagator(0.05, 250));
+}
+
+}  // namespace
+}  // namespace smileexplorer
@@ -1,13 +1,37 @@
 #ifndef SMILEEXPLORER_TREES_PROPAGATORS_H_
 #define SMILEEXPLORER_TREES_PROPAGATORS_H_
 
+#include <Eigen/Dense>
+#include <algorithm>
 #include <cmath>
 
 #include "rates/rates_curve.h"
+#include "time/timegrid.h"
 #include "trees/binomial_tree.h"
 
 namespace smileexplorer {
 
+// Log-space moves into time index t, for propagators whose up and down moves
+// depend only on time: the up move is drift + diffusion and the down move is
+// drift - diffusion. Propagators which provide this (via a latticeStep method)
+// can be represented as an implicit lattice, without storing every node.
+struct LatticeStep {
+  double drift;
+  double diffusion;
+};
+
+namespace internal {
+
+// True if node (t, i) has no stored node below it at t - 1 to move up from,
+// i.e. if it is node 0 or the lowest node of a truncated tree (see
+// BinomialTree::materializedNodes). Such a node moves down from node
+// (t - 1, i) instead.
+inline bool isLowestNode(const BinomialTree& tree, int t, int i) {
+  return !tree.materializedNodes(t - 1).contains(i - 1);
+}
+
+}  // namespace internal
+
 // CRR = Cox-Ross-Rubinstein convention for forward-propagation of a stochastic
 // variable in a binomial tree.
 // The main characteristic is that up_move == -down_move.
@@ -25,15 +49,25 @@ struct CRRPropagator {
     double dt = tree.timestepAt(t);
     double u = vol_fn.get(curr_time) * std::sqrt(dt);
 
-    if (i == 0) {
+    if (internal::isLowestNode(tree, t, i)) {
       double d = -u;
-      return tree.nodeValue(t - 1, 0) * std::exp(d);
+      return tree.nodeValue(t - 1, i) * std::exp(d);
     }
 
     return tree.nodeValue(t - 1, i - 1) * std::exp(u);
   }
 
+  template <typename VolatilityT>
+  LatticeStep latticeStep(const Timegrid& timegrid,
+                          const VolatilityT& vol_fn,
+                          int t) const {
+    const double dt = timegrid.dt(t);
+    return {.drift = 0.0,
+            .diffusion = vol_fn.get(timegrid.time(t)) * std::sqrt(dt)};
+  }
+
   void updateSpot(double spot) { spot_price_ = spot; }
+  double spot() const { return spot_price_; }
 
  private:
   double spot_price_;
@@ -57,21 +91,200 @@ struct JarrowRuddPropagator {
     double dt = tree.timestepAt(t);
     double curr_time = tree.totalTimeAtIndex(t);
 
-    if (i == 0) {
+    if (internal::isLowestNode(tree, t, i)) {
       double d = expected_drift_ * dt - vol_fn.get(curr_time) * std::sqrt(dt);
-      return tree.nodeValue(t - 1, 0) * std::exp(d);
+      return tree.nodeValue(t - 1, i) * std::exp(d);
     } else {
       double u = expected_drift_ * dt + vol_fn.get(curr_time) * std::sqrt(dt);
       return tree.nodeValue(t - 1, i - 1) * std::exp(u);
     }
   }
 
+  template <typename VolatilityT>
+  LatticeStep latticeStep(const Timegrid& timegrid,
+                          const VolatilityT& vol_fn,
+                          int t) const {
+    const double dt = timegrid.dt(t);
+    return {.drift = expected_drift_ * dt,
+            .diffusion = vol_fn.get(timegrid.time(t)) * std::sqrt(dt)};
+  }
+
   void updateSpot(double spot) { spot_price_ = spot; }
+  double spot() const { return spot_price_; }
 
   double expected_drift_;
   double spot_price_;
 };
 
+namespace internal {
+
+// Risk-neutral growth of the asset over [t_start, t_end], as in
+// BinomialTransitionTable.
+inline double riskNeutralGrowth(const RatesCurve& curve,
+                                const RatesCurve* foreign_curve,
+                                double t_start,
+                                double t_end) {
+  double growth = curve.inverseForwardDF(t_start, t_end);
+  if (foreign_curve != nullptr) {
+    growth /= foreign_curve->inverseForwardDF(t_start, t_end);
+  }
+  return growth;
+}
+
+// The lattice step with multiplicative up and down moves u and d.
+inline LatticeStep latticeStepFromMoves(double u, double d) {
+  return {.drift = 0.5 * std::log(u * d),
+          .diffusion = 0.5 * std::log(u / d)};
+}
+
+}  // namespace internal
+
+// Leisen-Reimer convention for forward-propagation of a stochastic variable in
+// a binomial tree, for pricing an option with a given strike and expiry.
+//
+// The up-probability is chosen by a Peizer-Pratt inversion of the normal
+// distribution such that, after N steps, the binomial distribution matches
+// N(d2) and the moves match N(d1) of Black-Scholes. Convergence to
+// Black-Scholes is then O(1/N^2) and free of the odd-even oscillation of CRR,
+// provided N (the number of timesteps until `expiry_years`) is odd, which
+// centres the strike between two terminal nodes. The moves depend on the spot
+// and strike, so the tree is only suitable for options near this strike and
+// expiry. Pass a foreign curve for currency options.
+//
+// Only flat vols are supported: the moves are those of the vol until expiry
+// over N equal timesteps, whereas the timegrid of a term structure is not
+// uniform and its vol changes along the way.
+struct LeisenReimerPropagator {
+  LeisenReimerPropagator(const RatesCurve& curve,
+                         double spot_price,
+                         double strike,
+                         double expiry_years,
+                         const RatesCurve* foreign_curve = nullptr)
+      : curve_(curve),
+        foreign_curve_(foreign_curve),
+        spot_price_(spot_price),
+        strike_(strike),
+        expiry_years_(expiry_years) {}
+
+  // The moves depend on the spot, so an implicit lattice cannot just be
+  // rescaled when it moves (see StochasticTreeModel::updateSpot).
+  static constexpr bool kMovesDependOnSpot = true;
+
+  template <typename VolatilityT>
+    requires(VolatilityT::SurfaceType::type ==
+             VolSurfaceFnType::kBlackScholesMerton)
+  double operator()(const BinomialTree& tree,
+                    const VolatilityT& vol_fn,
+                    int t,
+                    int i) const {
+    if (t == 0) return spot_price_;
+    const auto step = latticeStep(tree.getTimegrid(), vol_fn, t);
+    if (internal::isLowestNode(tree, t, i)) {
+      return tree.nodeValue(t - 1, i) * std::exp(step.drift - step.diffusion);
+    }
+    return tree.nodeValue(t - 1, i - 1) *
+           std::exp(step.drift + step.diffusion);
+  }
+
+  // An expiry shorter than the timestep (including a non-positive one, which
+  // has no Black-Scholes d1 and d2) is treated as a single timestep.
+  template <typename VolatilityT>
+    requires(VolatilityT::SurfaceType::type ==
+             VolSurfaceFnType::kBlackScholesMerton)
+  LatticeStep latticeStep(const Timegrid& timegrid,
+                          const VolatilityT& vol_fn,
+                          int t) const {
+    const double t_start = timegrid.time(t - 1);
+    const double t_end = timegrid.time(t);
+    const double dt = t_end - t_start;
+    const double expiry_years = std::max(expiry_years_, dt);
+    const double vol = vol_fn.get(expiry_years);
+    const int n = std::max(1L, std::lround(expiry_years / dt));
+
+    const double forward =
+        spot_price_ *
+        internal::riskNeutralGrowth(curve_, foreign_curve_, 0.0, expiry_years);
+    const double std_dev = vol * std::sqrt(expiry_years);
+    const double d1 = std::log(forward / strike_) / std_dev + 0.5 * std_dev;
+    const double d2 = d1 - std_dev;
+    const double p = peizerPratt(d2, n);
+    const double growth =
+        internal::riskNeutralGrowth(curve_, foreign_curve_, t_start, t_end);
+    const double u = growth * peizerPratt(d1, n) / p;
+    const double d = (growth - p * u) / (1 - p);
+    return internal::latticeStepFromMoves(u, d);
+  }
+
+  void updateSpot(double spot) { spot_price_ = spot; }
+  double spot() const { return spot_price_; }
+
+ private:
+  const RatesCurve& curve_;
+  const RatesCurve* foreign_curve_;
+  double spot_price_;
+  double strike_;
+  double expiry_years_;
+
+  // Peizer-Pratt method 2: the probability of success in each of n binomial
+  // trials which approximates N(z) as the probability of a majority.
+  static double peizerPratt(double z, int n) {
+    const double x = z / (n + 1 / 3. + 0.1 / (n + 1));
+    return 0.5 + std::copysign(
+                     0.5 * std::sqrt(1 - std::exp(-x * x * (n + 1 / 6.))), z);
+  }
+};
+
+// Tian convention for forward-propagation of a stochastic variable in a
+// binomial tree.
+//
+// The up and down moves match the first three moments of the lognormal
+// distribution over each timestep (rather than two, as CRR does), which
+// reduces the oscillation of prices with the number of timesteps. Pass a
+// foreign curve for currency options.
+struct TianPropagator {
+  TianPropagator(const RatesCurve& curve,
+                 double spot_price,
+                 const RatesCurve* foreign_curve = nullptr)
+      : curve_(curve), foreign_curve_(foreign_curve), spot_price_(spot_price) {}
+
+  template <typename VolatilityT>
+  double operator()(const BinomialTree& tree,
+                    const VolatilityT& vol_fn,
+                    int t,
+                    int i) const {
+    if (t == 0) return spot_price_;
+    const auto step = latticeStep(tree.getTimegrid(), vol_fn, t);
+    if (internal::isLowestNode(tree, t, i)) {
+      return tree.nodeValue(t - 1, i) * std::exp(step.drift - step.diffusion);
+    }
+    return tree.nodeValue(t - 1, i - 1) *
+           std::exp(step.drift + step.diffusion);
+  }
+
+  template <typename VolatilityT>
+  LatticeStep latticeStep(const Timegrid& timegrid,
+                          const VolatilityT& vol_fn,
+                          int t) const {
+    const double t_start = timegrid.time(t - 1);
+    const double t_end = timegrid.time(t);
+    const double vol = vol_fn.get(t_end);
+    const double m =
+        internal::riskNeutralGrowth(curve_, foreign_curve_, t_start, t_end);
+    const double v = std::exp(vol * vol * (t_end - t_start));
+    const double root = std::sqrt(v * v + 2 * v - 3);
+    return internal::latticeStepFromMoves(0.5 * m * v * (v + 1 + root),
+                                          0.5 * m * v * (v + 1 - root));
+  }
+
+  void updateSpot(double spot) { spot_price_ = spot; }
+  double spot() const { return spot_price_; }
+
+ private:
+  const RatesCurve& curve_;
+  const RatesCurve* foreign_curve_;
+  double spot_price_;
+};
+
 // Note: This could also be done as a SFINAE-style override in the CRRPropagator
 // (since that is the approach) but for now separating this out seems like a
 // reasonable approach.
@@ -147,11 +360,73 @@ struct LocalVolatilityPropagator {
     }
   }
 
+  // Populates the `nodes` of timeslice t > 0 at once, into the entries of
+  // `row` at their node indices, with the same results as operator().
+  // The local vol is evaluated for the whole previous timeslice in one batch,
+  // and the discount factors once, rather than node by node. Each node still
+  // depends on its neighbour towards the spine, so the nodes above and below
+  // the spine are filled outwards from it.
+  template <typename VolatilityT>
+  void propagateTimeslice(const BinomialTree& tree,
+                          const VolatilityT& vol_fn,
+                          int t,
+                          NodeRange nodes,
+                          Eigen::ArrayXd& row) {
+    // The upper nodes (and the upper spine) grow out of the previous node
+    // below them, and the lower nodes out of the previous node above them.
+    const NodeRange prev{nodes.first, nodes.last - 1};
+    if (prev_states_.size() < t) {
+      prev_states_.resize(tree.numTimesteps() + 1);
+      vols_.resize(tree.numTimesteps() + 1);
+      forwards_.resize(tree.numTimesteps() + 1);
+      variances_.resize(tree.numTimesteps() + 1);
+    }
+    const int n = prev.size();
+    auto S = prev_states_.segment(prev.first, n);
+    auto sigma = vols_.segment(prev.first, n);
+    tree.copyTimeslice(t - 1, prev, S);
+    vol_fn.getBatch(S, sigma);
+
+    const double dt = tree.timestepAt(t - 1);
+    const double df_prev = curve_.df(tree.totalTimeAtIndex(t - 1));
+    const double df_curr = curve_.df(tree.totalTimeAtIndex(t));
+    forwards_.segment(prev.first, n) = S * df_prev / df_curr;
+    variances_.segment(prev.first, n) = S * S * sigma * sigma * dt;
+
+    int upper_spine = t / 2;
+    int lower_spine = t / 2;
+    if (t % 2 == 0) {
+      row[t / 2] = spot_price_;
+    } else {
+      upper_spine = (t + 1) / 2;
+      lower_spine = (t - 1) / 2;
+      const int j = (t - 1) / 2;
+      row[upper_spine] = prev_states_[j] * std::exp(vols_[j] * std::sqrt(dt));
+      row[lower_spine] = prev_states_[j] * std::exp(-vols_[j] * std::sqrt(dt));
+    }
+
+    // Neighbours are read back as the tree stores them, as in operator().
+    for (int i = upper_spine + 1; i <= nodes.last; ++i) {
+      const double S_d = tree.roundToStorage(row[i - 1]);
+      row[i] = forwards_[i - 1] + variances_[i - 1] / (forwards_[i - 1] - S_d);
+    }
+    for (int i = lower_spine - 1; i >= nodes.first; --i) {
+      const double S_u = tree.roundToStorage(row[i + 1]);
+      row[i] = forwards_[i] - variances_[i] / (S_u - forwards_[i]);
+    }
+  }
+
   void updateSpot(double spot) { spot_price_ = spot; }
 
  private:
   const RatesCurve& curve_;
   double spot_price_;
+
+  // Scratch space for propagateTimeslice, indexed by node.
+  Eigen::ArrayXd prev_states_;
+  Eigen::ArrayXd vols_;
+  Eigen::ArrayXd forwards_;
+  Eigen::ArrayXd variances_;
 };
 
 }  // namespace smileexplorer
@@ -2,8 +2,12 @@
 #ifndef SMILEEXPLORER_TREES_STOCHASTIC_TREE_MODEL_H_
 #define SMILEEXPLORER_TREES_STOCHASTIC_TREE_MODEL_H_
 
+#include <Eigen/Dense>
+#include <cmath>
+
 #include "absl/log/log.h"
 #include "trees/binomial_tree.h"
+#include "volatility/volatility.h"
 
 namespace smileexplorer {
 
@@ -16,10 +20,46 @@ class StochasticTreeModel {
   StochasticTreeModel(BinomialTree binomial_tree, PropagatorT propagator)
       : binomial_tree_(binomial_tree), propagator_(propagator) {}
 
+  // True if the tree can be stored as an implicit lattice (see
+  // BinomialTree::setImplicitLattice): the propagator's moves depend only on
+  // time, and so does the volatility.
+  template <typename VolatilityT>
+  static constexpr bool supportsImplicitLattice() {
+    constexpr auto vol_type = VolatilityT::SurfaceType::type;
+    return requires(const PropagatorT& propagator,
+                    const Timegrid& timegrid,
+                    const VolatilityT& volatility) {
+      propagator.latticeStep(timegrid, volatility, 0);
+    } && (vol_type == VolSurfaceFnType::kBlackScholesMerton ||
+          vol_type == VolSurfaceFnType::kTermStructure);
+  }
+
+  // True if the propagator can populate a whole timeslice at once (see
+  // LocalVolatilityPropagator::propagateTimeslice).
+  template <typename VolatilityT>
+  static constexpr bool supportsTimeslicePropagation() {
+    return requires(PropagatorT& propagator,
+                    const BinomialTree& tree,
+                    const VolatilityT& volatility,
+                    Eigen::ArrayXd& row) {
+      propagator.propagateTimeslice(tree, volatility, 1, NodeRange{}, row);
+    };
+  }
+
   template <typename VolatilityT>
   void forwardPropagate(const VolatilityT& volatility) {
+    if constexpr (supportsImplicitLattice<VolatilityT>()) {
+      forwardPropagateImplicitLattice(volatility);
+      return;
+    }
+
     binomial_tree_.resizeWithTimeDependentVol(volatility);
 
+    if constexpr (supportsTimeslicePropagation<VolatilityT>()) {
+      forwardPropagateTimeslices(volatility);
+      return;
+    }
+
     // bool at_least_one_negative_node = false;
 
     for (int t = 0; t < binomial_tree_.numTimesteps(); ++t) {
@@ -40,13 +80,17 @@ class StochasticTreeModel {
             propagator_(binomial_tree_, volatility, t, (t - 1) / 2));
       }
 
-      // Fix all the nodes above the spine.
-      for (int i = std::floor((t + 2) / 2); i <= t; ++i) {
+      // Fix all the nodes above the spine. (In a truncated tree, only those
+      // within its band.)
+      const NodeRange nodes = binomial_tree_.materializedNodes(t);
+      for (int i = std::floor((t + 2) / 2); i <= nodes.last; ++i) {
         binomial_tree_.setValue(
             t, i, propagator_(binomial_tree_, volatility, t, i));
       }
-      // And then below the spine.
-      for (int i = std::floor((t - 2) / 2); i >= 0; --i) {
+      // And then below the spine. (In a truncated tree, the lowest node may
+      // have no stored node below it at t - 1, in which case the propagator
+      // moves down to it instead; see internal::isLowestNode.)
+      for (int i = std::floor((t - 2) / 2); i >= nodes.first; --i) {
         double node_value = propagator_(binomial_tree_, volatility, t, i);
         // at_least_one_negative_node |= node_value < 0;
         binomial_tree_.setValue(t, i, node_value);
@@ -66,11 +110,75 @@ class StochasticTreeModel {
     }
   }
 
-  void updateSpot(double spot) { propagator_.updateSpot(spot); }
+  // Returns true if the tree has been updated for the new spot. This is the
+  // case for implicit lattices, which are stored in units of the spot and
+  // only need rescaling, unless the propagator's moves depend on the spot
+  // (e.g. LeisenReimerPropagator). Otherwise, the new spot only takes effect
+  // at the next forwardPropagate.
+  bool updateSpot(double spot) {
+    propagator_.updateSpot(spot);
+    constexpr bool moves_depend_on_spot =
+        requires { requires PropagatorT::kMovesDependOnSpot; };
+    if (binomial_tree_.isImplicitLattice() && !moves_depend_on_spot) {
+      binomial_tree_.setLatticeSpot(spot);
+      return true;
+    }
+    return false;
+  }
 
   const BinomialTree& binomialTree() const { return binomial_tree_; }
 
  private:
+  // Node (t, i) is reached by i up moves and t - i down moves, so with
+  // cumulative drift D_t and cumulative diffusion U_t it is equal to
+  //   S_0 * exp(D_t + U_t) * exp(-2 * U_{t-i}).
+  // Only these two factors are computed per timestep, which replaces the
+  // O(N^2) exp() calls (and storage) with O(N). They do not depend on S_0,
+  // which is kept separately (see updateSpot).
+  template <typename VolatilityT>
+  void forwardPropagateImplicitLattice(const VolatilityT& volatility) {
+    Timegrid timegrid =
+        volatility.generateTimegrid(binomial_tree_.treeDurationYears(),
+                                    binomial_tree_.exactTimestepInYears());
+    const double spot = propagator_(binomial_tree_, volatility, 0, 0);
+
+    // As with explicit forward propagation, the final timeslice is left
+    // empty, which a zero time factor represents.
+    Eigen::VectorXd time_factors = Eigen::VectorXd::Zero(timegrid.size());
+    Eigen::VectorXd path_factors = Eigen::VectorXd::Zero(timegrid.size());
+    time_factors[0] = 1.0;
+    path_factors[0] = 1.0;
+    double cumulative_drift = 0.0;
+    double cumulative_diffusion = 0.0;
+    for (int t = 1; t < timegrid.size() - 1; ++t) {
+      const auto step = propagator_.latticeStep(timegrid, volatility, t);
+      cumulative_drift += step.drift;
+      cumulative_diffusion += step.diffusion;
+      time_factors[t] = std::exp(cumulative_drift + cumulative_diffusion);
+      path_factors[t] = std::exp(-2 * cumulative_diffusion);
+    }
+
+    binomial_tree_.setImplicitLattice(std::move(timegrid),
+                                      std::move(time_factors),
+                                      std::move(path_factors),
+                                      spot);
+  }
+
+  template <typename VolatilityT>
+  void forwardPropagateTimeslices(const VolatilityT& volatility) {
+    binomial_tree_.setValue(
+        0, 0, propagator_(binomial_tree_, volatility, 0, 0));
+    Eigen::ArrayXd row(binomial_tree_.numTimesteps() + 1);
+    for (int t = 1; t < binomial_tree_.numTimesteps(); ++t) {
+      // In a truncated tree, only the nodes within its band.
+      const NodeRange nodes = binomial_tree_.materializedNodes(t);
+      propagator_.propagateTimeslice(
+          binomial_tree_, volatility, t, nodes, row);
+      binomial_tree_.setTimeslice(
+          t, nodes, row.segment(nodes.first, nodes.size()));
+    }
+  }
+
   BinomialTree binomial_tree_;
   PropagatorT propagator_;
 };
@@ -1,5 +1,7 @@
 #include "trees/stochastic_tree_model.h"
 
+#include <cmath>
+
 #include <gtest/gtest.h>
 
 #include "derivatives/derivative.h"
@@ -123,7 +125,7 @@ TEST(StochasticTreeModelTest, DermanChapter14_2) {
       {.1017, .3523, .4022, .1437},
       {.0436, .2036, .3646, .2966, .0916}};
 
-  EXPECT_THAT(deriv.arrowDebreuTree(),
+  EXPECT_THAT(*deriv.arrowDebreuTree(),
               BinomialTreeMatchesUpToTimeIndex(expected, 0.0001));
 }
 
@@ -153,5 +155,300 @@ TEST(StochasticTreeModelTest, DermanChapter14_3) {
   EXPECT_NEAR(0.12, price, 0.005);
 }
 
+// Forwards to another propagator, but hides its latticeStep so that the tree
+// is forward-propagated and stored node by node.
+template <typename PropagatorT>
+struct ExplicitOnly {
+  template <typename VolatilityT>
+  double operator()(const BinomialTree& tree,
+                    const VolatilityT& vol_fn,
+                    int t,
+                    int i) const {
+    return propagator(tree, vol_fn, t, i);
+  }
+  PropagatorT propagator;
+};
+
+struct RisingTermStructureVol {
+  static constexpr VolSurfaceFnType type = VolSurfaceFnType::kTermStructure;
+  double operator()(double t) const { return t <= 1 ? 0.15 : 0.25; }
+};
+
+template <typename PropagatorT, typename VolatilityT>
+void expectImplicitLatticeMatchesExplicitTree(const PropagatorT& propagator,
+                                              const VolatilityT& vol) {
+  StochasticTreeModel implicit_asset(BinomialTree(2.0, 1 / 52.), propagator);
+  implicit_asset.forwardPropagate(vol);
+  StochasticTreeModel explicit_asset(BinomialTree(2.0, 1 / 52.),
+                                     ExplicitOnly<PropagatorT>{propagator});
+  explicit_asset.forwardPropagate(vol);
+
+  const auto& implicit_tree = implicit_asset.binomialTree();
+  const auto& explicit_tree = explicit_asset.binomialTree();
+  EXPECT_TRUE(implicit_tree.isImplicitLattice());
+  EXPECT_FALSE(explicit_tree.isImplicitLattice());
+  ASSERT_EQ(explicit_tree.numTimesteps(), implicit_tree.numTimesteps());
+
+  for (int t = 0; t <= explicit_tree.numTimesteps(); ++t) {
+    EXPECT_EQ(explicit_tree.isTreeEmptyAt(t), implicit_tree.isTreeEmptyAt(t));
+    EXPECT_DOUBLE_EQ(explicit_tree.totalTimeAtIndex(t),
+                     implicit_tree.totalTimeAtIndex(t));
+    for (int i = 0; i <= t; ++i) {
+      const double expected = explicit_tree.nodeValue(t, i);
+      EXPECT_NEAR(expected, implicit_tree.nodeValue(t, i), expected * 1e-12);
+    }
+  }
+}
+
+TEST(StochasticTreeModelTest, ImplicitLatticeMatchesExplicitTree) {
+  expectImplicitLatticeMatchesExplicitTree(CRRPropagator(100),
+                                           Volatility(FlatVol(0.2)));
+  expectImplicitLatticeMatchesExplicitTree(JarrowRuddPropagator(0.05, 100),
+                                           Volatility(FlatVol(0.2)));
+  expectImplicitLatticeMatchesExplicitTree(
+      CRRPropagator(100), Volatility(RisingTermStructureVol()));
+
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  expectImplicitLatticeMatchesExplicitTree(
+      LeisenReimerPropagator(curve, 100, 105, 1.0), Volatility(FlatVol(0.2)));
+  expectImplicitLatticeMatchesExplicitTree(
+      TianPropagator(curve, 100), Volatility(RisingTermStructureVol()));
+}
+
+template <typename PropagatorT, typename VolatilityT>
+constexpr bool propagatesWith() {
+  return requires(const PropagatorT& propagator,
+                  const BinomialTree& tree,
+                  const VolatilityT& vol) { propagator(tree, vol, 1, 0); };
+}
+
+TEST(StochasticTreeModelTest, LeisenReimerRejectsTermStructureVols) {
+  // The timegrid of a term structure is not uniform, so there is no single
+  // vol and number of timesteps until expiry to choose the moves from.
+  using FlatVolatility = Volatility<FlatVol>;
+  using TermStructureVolatility = Volatility<RisingTermStructureVol>;
+  EXPECT_TRUE((propagatesWith<LeisenReimerPropagator, FlatVolatility>()));
+  EXPECT_FALSE(
+      (propagatesWith<LeisenReimerPropagator, TermStructureVolatility>()));
+  EXPECT_TRUE(StochasticTreeModel<LeisenReimerPropagator>::
+                  supportsImplicitLattice<FlatVolatility>());
+  EXPECT_FALSE(StochasticTreeModel<LeisenReimerPropagator>::
+                   supportsImplicitLattice<TermStructureVolatility>());
+
+  // Other propagators still accept them.
+  EXPECT_TRUE((propagatesWith<CRRPropagator, TermStructureVolatility>()));
+}
+
+TEST(StochasticTreeModelTest, SpotDependentLatticesAreNotRescaled) {
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  StochasticTreeModel asset(BinomialTree(1.1, 1 / 51.),
+                            LeisenReimerPropagator(curve, 100, 105, 1.0));
+  const Volatility vol(FlatVol(0.2));
+  asset.forwardPropagate(vol);
+  ASSERT_TRUE(asset.binomialTree().isImplicitLattice());
+  const double up_ratio = asset.binomialTree().nodeValue(1, 1) / 100;
+
+  // The moves depend on the spot, so the tree is only updated by the next
+  // forward propagation.
+  EXPECT_FALSE(asset.updateSpot(90));
+  EXPECT_DOUBLE_EQ(100, asset.binomialTree().nodeValue(0, 0));
+  asset.forwardPropagate(vol);
+  EXPECT_DOUBLE_EQ(90, asset.binomialTree().nodeValue(0, 0));
+  EXPECT_NE(up_ratio, asset.binomialTree().nodeValue(1, 1) / 90);
+}
+
+TEST(StochasticTreeModelTest, LeisenReimerTreesSurviveExpiredOptions) {
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  const Volatility vol(FlatVol(0.2));
+  const double dt = 1 / 51.;
+  for (double expiry_years : {0.0, -1.0, dt / 4}) {
+    StochasticTreeModel asset(
+        BinomialTree(1.1, dt),
+        LeisenReimerPropagator(curve, 100, 105, expiry_years));
+    asset.forwardPropagate(vol);
+
+    // As if the expiry were a single timestep away.
+    StochasticTreeModel one_step_asset(
+        BinomialTree(1.1, dt), LeisenReimerPropagator(curve, 100, 105, dt));
+    one_step_asset.forwardPropagate(vol);
+    for (int t = 0; t < asset.binomialTree().numTimesteps() - 1; ++t) {
+      for (int i = 0; i <= t; ++i) {
+        const double node = asset.binomialTree().nodeValue(t, i);
+        ASSERT_TRUE(std::isfinite(node)) << t << ", " << i;
+        EXPECT_NEAR(
+            one_step_asset.binomialTree().nodeValue(t, i), node, node * 1e-12);
+      }
+    }
+  }
+}
+
+// Like the smile in the explorer: higher vols for lower spots.
+struct SigmoidLocalVol {
+  static constexpr VolSurfaceFnType type =
+      VolSurfaceFnType::kTimeInvariantSkewSmile;
+  double operator()(double s) const {
+    return 0.15 + 0.1 / (1 + std::exp(0.05 * (s - 100)));
+  }
+};
+
+TEST(StochasticTreeModelTest, LocalVolTimeslicesMatchNodeByNode) {
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  const Volatility vol(SigmoidLocalVol{});
+  for (const bool truncated : {false, true}) {
+    for (const auto precision :
+         {StoragePrecision::kDouble, StoragePrecision::kSingle}) {
+      BinomialTree tree(1.0, 1 / 200.);
+      if (truncated) {
+        tree.truncate(4);
+      }
+      tree.setStoragePrecision(precision);
+
+      StochasticTreeModel asset(tree, LocalVolatilityPropagator(curve, 100));
+      asset.forwardPropagate(vol);
+      StochasticTreeModel node_by_node_asset(
+          tree, ExplicitOnly<LocalVolatilityPropagator>{{curve, 100}});
+      node_by_node_asset.forwardPropagate(vol);
+
+      const auto& expected = node_by_node_asset.binomialTree();
+      const auto& actual = asset.binomialTree();
+      ASSERT_EQ(expected.numTimesteps(), actual.numTimesteps());
+      for (int t = 0; t <= expected.numTimesteps(); ++t) {
+        for (int i = 0; i <= t; ++i) {
+          ASSERT_EQ(expected.nodeValue(t, i), actual.nodeValue(t, i))
+              << "t = " << t << ", i = " << i << ", truncated = " << truncated;
+        }
+      }
+    }
+  }
+}
+
+TEST(StochasticTreeModelTest, TruncatedExplicitTreesMatchTheFullTree) {
+  // 400 timesteps until expiry, and the usual final, empty timeslice.
+  BinomialTree full_tree(1.0 + 2 / 400., 1 / 400.);
+  BinomialTree truncated_tree = full_tree;
+  truncated_tree.truncate(4);
+
+  StochasticTreeModel full_asset(
+      full_tree, ExplicitOnly<CRRPropagator>{CRRPropagator(100)});
+  full_asset.forwardPropagate(Volatility(FlatVol(0.2)));
+  StochasticTreeModel truncated_asset(
+      truncated_tree, ExplicitOnly<CRRPropagator>{CRRPropagator(100)});
+  truncated_asset.forwardPropagate(Volatility(FlatVol(0.2)));
+
+  const auto& expected = full_asset.binomialTree();
+  const auto& actual = truncated_asset.binomialTree();
+  ASSERT_EQ(expected.numTimesteps(), actual.numTimesteps());
+  for (int t = 0; t < expected.numTimesteps(); ++t) {
+    const NodeRange nodes = actual.materializedNodes(t);
+    for (int i = nodes.first; i <= nodes.last; ++i) {
+      ASSERT_NEAR(expected.nodeValue(t, i),
+                  actual.nodeValue(t, i),
+                  expected.nodeValue(t, i) * 1e-12)
+          << "t = " << t << ", i = " << i;
+    }
+  }
+
+  // A smile also makes the tree explicit. Its band does not move on every
+  // timestep, which is where the lowest node needs a down move.
+  ZeroSpotCurve curve({1.0, 10.0}, {0.04, 0.05});
+  StochasticTreeModel full_smile_asset(full_tree, CRRPropagator(100));
+  full_smile_asset.forwardPropagate(Volatility(SigmoidLocalVol{}));
+  StochasticTreeModel truncated_smile_asset(truncated_tree, CRRPropagator(100));
+  truncated_smile_asset.forwardPropagate(Volatility(SigmoidLocalVol{}));
+  const VanillaOption put(100, OptionPayoff::Put, ExerciseStyle::American);
+  EXPECT_NEAR(
+      SingleAssetDerivative(&full_smile_asset.binomialTree(), &curve)
+          .price(put, 1.0),
+      SingleAssetDerivative(&truncated_smile_asset.binomialTree(), &curve)
+          .price(put, 1.0),
+      1e-3);
+}
+
+TEST(StochasticTreeModelTest, TruncationBandIsCentredOnTheForward) {
+  // Over five years at 10%, the forward drifts more than a standard deviation
+  // away from the spine.
+  ZeroSpotCurve curve({1.0, 10.0}, {0.10, 0.10});
+  const Volatility vol(FlatVol(0.2));
+  const int n = 1000;
+  const double dt = 5.0 / n;
+  BinomialTree tree(5.0 + 2 * dt, dt);
+  BinomialTree spine_tree = tree;
+  spine_tree.truncate(4);
+  BinomialTree forward_tree = tree;
+  forward_tree.truncate(4, curve, 0.2);
+
+  StochasticTreeModel full_asset(tree, CRRPropagator(100));
+  full_asset.forwardPropagate(vol);
+  StochasticTreeModel spine_asset(spine_tree, CRRPropagator(100));
+  spine_asset.forwardPropagate(vol);
+  StochasticTreeModel forward_asset(forward_tree, CRRPropagator(100));
+  forward_asset.forwardPropagate(vol);
+
+  // Adjacent nodes are 2 * vol * sqrt(dt) apart in log space.
+  const double log_forward = std::log(100 / curve.df(5.0));
+  const auto logMidpoint = [&](const BinomialTree& band_tree) {
+    const NodeRange active = band_tree.activeNodes(n);
+    return 0.5 * (std::log(band_tree.nodeValue(n, active.first)) +
+                  std::log(band_tree.nodeValue(n, active.last)));
+  };
+  const double node_spacing = 2 * 0.2 * std::sqrt(dt);
+  EXPECT_GT(std::abs(logMidpoint(spine_asset.binomialTree()) - log_forward),
+            10 * node_spacing);
+  EXPECT_LT(std::abs(logMidpoint(forward_asset.binomialTree()) - log_forward),
+            2 * node_spacing);
+
+  const VanillaOption put(100, OptionPayoff::Put, ExerciseStyle::American);
+  const double price =
+      SingleAssetDerivative(&full_asset.binomialTree(), &curve).price(put, 5.0);
+  EXPECT_NEAR(
+      price,
+      SingleAssetDerivative(&forward_asset.binomialTree(), &curve)
+          .price(put, 5.0),
+      2e-4);
+
+  // Explicitly propagated trees are centred the same way, and match the full
+  // tree within their band.
+  const Volatility local_vol(SigmoidLocalVol{});
+  BinomialTree lv_tree(2.0, 1 / 200.);
+  StochasticTreeModel full_lv_asset(lv_tree,
+                                    LocalVolatilityPropagator(curve, 100));
+  full_lv_asset.forwardPropagate(local_vol);
+  lv_tree.truncate(4, curve, 0.2);
+  StochasticTreeModel truncated_lv_asset(lv_tree,
+                                         LocalVolatilityPropagator(curve, 100));
+  truncated_lv_asset.forwardPropagate(local_vol);
+  const auto& expected = full_lv_asset.binomialTree();
+  const auto& actual = truncated_lv_asset.binomialTree();
+  const int t_last = actual.numTimesteps() - 1;
+  const NodeRange active = actual.activeNodes(t_last);
+  EXPECT_GT(active.first + active.last, t_last + 2);
+  for (int t = 0; t <= t_last; ++t) {
+    const NodeRange nodes = actual.materializedNodes(t);
+    for (int i = nodes.first; i <= nodes.last; ++i) {
+      ASSERT_EQ(expected.nodeValue(t, i), actual.nodeValue(t, i))
+          << "t = " << t << ", i = " << i;
+    }
+  }
+}
+
+TEST(StochasticTreeModelTest, ImplicitLatticeDerivativeTreesAreExplicit) {
+  StochasticTreeModel asset(BinomialTree(1.1, 1 / 100.), CRRPropagator(100));
+  asset.forwardPropagate(Volatility(FlatVol(0.2)));
+  ASSERT_TRUE(asset.binomialTree().isImplicitLattice());
+
+  ZeroSpotCurve curve({1.0, 10.0}, {0.05, 0.05});
+  SingleAssetDerivative deriv(&asset.binomialTree(), &curve);
+  const VanillaOption put(100, OptionPayoff::Put, ExerciseStyle::American);
+  const double price = deriv.price(put, 1.0);
+  EXPECT_FALSE(deriv.binomialTree().isImplicitLattice());
+  EXPECT_DOUBLE_EQ(price, deriv.binomialTree().nodeValue(0, 0));
+
+  SingleAssetDerivative rolling_deriv(
+      &asset.binomialTree(),
+      &curve,
+      BackwardInductionStorage::kRollingTimeslices);
+  EXPECT_DOUBLE_EQ(price, rolling_deriv.price(put, 1.0));
+}
+
 }  // namespace
 }  // namespace smileexplorer
@@ -43,6 +43,8 @@ struct FlatVol {
 template <typename VolSurfaceT>
 class Volatility {
  public:
+  using SurfaceType = VolSurfaceT;
+
   Volatility(VolSurfaceT vol_surface) : vol_surface_(vol_surface) {}
 
   template <typename... Args>
@@ -50,6 +52,13 @@ class Volatility {
     return vol_surface_(std::forward<Args>(args)...);
   }
 
+  // Evaluates the surface at each of `args` (e.g. the asset states of a
+  // timeslice) into the Eigen array (or array block) `out`.
+  template <typename ArgsT, typename OutT>
+  void getBatch(const Eigen::ArrayBase<ArgsT>& args, OutT&& out) const {
+    out = args.unaryExpr([this](double arg) { return vol_surface_(arg); });
+  }
+
   Timegrid generateTimegrid(double t_final, double initial_timestep) const;
 
  private: